@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.cpp"
+
+// One kinodynamics MPC tick while walking, with force variables for every
+// foot at every stage (0) or only for the feet in contact (1). In the second
+// case the single support stages lose the 6 force variables of their swing
+// foot, which shrinks their LQ subproblems. mean_nu is the mean control size
+// over the horizon.
+static void BM_iterate(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+
+  KinodynamicsSettings settings = getKinodynamicsSettings(handler);
+  settings.active_forces_only = state.range(0) == 1;
+  std::shared_ptr<Problem> problem =
+      std::make_shared<KinodynamicsProblem>(settings, handler);
+  MPCSettings mpc_settings = getMPCSettings(handler, 100);
+  mpc_settings.verbose = false;
+  problem->createProblem(handler.getState(), mpc_settings.T, 6,
+                         settings.gravity[2]);
+
+  MPC mpc(mpc_settings, problem);
+  mpc.generateCycleHorizon(getWalkingContactStates(handler));
+  // Reach a horizon with swing stages
+  for (std::size_t i = 0; i < mpc_settings.T; i++)
+    mpc.iterate(q, v);
+
+  double nu = 0;
+  for (auto _ : state) {
+    mpc.iterate(q, v);
+
+    state.PauseTiming();
+    for (std::size_t t = 0; t < problem->getSize(); t++)
+      nu += (double)problem->getProblem()->stages_[t]->nu();
+    state.ResumeTiming();
+  }
+  state.counters["mean_nu"] = benchmark::Counter(
+      nu / (double)problem->getSize(), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_iterate)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,221 @@
+#include "simple-mpc/fulldynamics.hpp"
+#include "simple-mpc/kinodynamics.hpp"
+#include "simple-mpc/mpc.hpp"
+#include "simple-mpc/robot-handler.hpp"
+
+using namespace simple_mpc;
+
+RobotHandler getTalosHandler() {
+  RobotHandlerSettings settings;
+  settings.urdf_path =
+      EXAMPLE_ROBOT_DATA_MODEL_DIR "/talos_data/robots/talos_reduced.urdf";
+  settings.srdf_path =
+      EXAMPLE_ROBOT_DATA_MODEL_DIR "/talos_data/srdf/talos.srdf";
+
+  settings.controlled_joints_names = {
+      "root_joint",        "leg_left_1_joint",  "leg_left_2_joint",
+      "leg_left_3_joint",  "leg_left_4_joint",  "leg_left_5_joint",
+      "leg_left_6_joint",  "leg_right_1_joint", "leg_right_2_joint",
+      "leg_right_3_joint", "leg_right_4_joint", "leg_right_5_joint",
+      "leg_right_6_joint", "torso_1_joint",     "torso_2_joint",
+      "arm_left_1_joint",  "arm_left_2_joint",  "arm_left_3_joint",
+      "arm_left_4_joint",  "arm_right_1_joint", "arm_right_2_joint",
+      "arm_right_3_joint", "arm_right_4_joint",
+  };
+  settings.end_effector_names = {"left_sole_link", "right_sole_link"};
+  settings.base_configuration = "half_sitting";
+  settings.root_name = "root_joint";
+
+  RobotHandler handler(settings);
+
+  return handler;
+}
+
+FullDynamicsSettings getFullDynamicsSettings(RobotHandler handler) {
+  int nv = handler.getModel().nv;
+  int nu = nv - 6;
+
+  FullDynamicsSettings settings;
+  settings.DT = 0.01;
+  settings.w_x = Eigen::MatrixXd::Identity(nv * 2, nv * 2);
+  settings.w_x.diagonal() << 0, 0, 0, 100, 100, 100, // Base pos/ori
+      0.1, 0.1, 0.1, 0.1, 0.1, 0.1,                  // Left leg
+      0.1, 0.1, 0.1, 0.1, 0.1, 0.1,                  // Right leg
+      10, 10,                                        // Torso
+      1, 1, 1, 1,                                    // Left arm
+      1, 1, 1, 1,                                    // Right arm
+      1, 1, 1, 1, 1, 1,                              // Base pos/ori vel
+      0.1, 0.1, 0.1, 0.1, 0.01, 0.01,                // Left leg vel
+      0.1, 0.1, 0.1, 0.1, 0.01, 0.01,                // Right leg vel
+      10, 10,                                        // Torso vel
+      1, 1, 1, 1,                                    // Left arm vel
+      1, 1, 1, 1;                                    // Right arm vel
+  settings.w_u = Eigen::MatrixXd::Identity(nu, nu) * 1e-4;
+  settings.w_cent = Eigen::MatrixXd::Identity(6, 6);
+  settings.w_cent.diagonal() << 0, 0, 10, 0, 0, 10;
+  settings.gravity << 0, 0, -9.81;
+  settings.force_size = 6;
+  settings.w_forces = Eigen::MatrixXd::Identity(6, 6) * 0.0001;
+  settings.w_frame = Eigen::MatrixXd::Identity(6, 6) * 2000;
+  settings.umin = -handler.getModel().effortLimit.tail(nu);
+  settings.umax = handler.getModel().effortLimit.tail(nu);
+  settings.qmin = handler.getModel().lowerPositionLimit.tail(nu);
+  settings.qmax = handler.getModel().upperPositionLimit.tail(nu);
+  settings.mu = 0.8;
+  settings.Lfoot = 0.1;
+  settings.Wfoot = 0.075;
+
+  return settings;
+}
+
+RobotHandler getGo2Handler() {
+  RobotHandlerSettings settings;
+  settings.urdf_path =
+      EXAMPLE_ROBOT_DATA_MODEL_DIR "/go2_description/urdf/go2.urdf";
+  settings.srdf_path =
+      EXAMPLE_ROBOT_DATA_MODEL_DIR "/go2_description/srdf/go2.srdf";
+
+  settings.controlled_joints_names = {
+      "root_joint",     "FL_hip_joint",   "FL_thigh_joint", "FL_calf_joint",
+      "FR_hip_joint",   "FR_thigh_joint", "FR_calf_joint",  "RL_hip_joint",
+      "RL_thigh_joint", "RL_calf_joint",  "RR_hip_joint",   "RR_thigh_joint",
+      "RR_calf_joint",
+  };
+  settings.end_effector_names = {"FL_foot", "FR_foot", "RL_foot", "RR_foot"};
+  settings.hip_names = {"FL_thigh_joint", "FR_thigh_joint", "RL_thigh_joint",
+                        "RR_thigh_joint"};
+  settings.base_configuration = "standing";
+  settings.root_name = "root_joint";
+
+  RobotHandler handler(settings);
+
+  return handler;
+}
+
+// Same weights as examples/go2_fulldynamics.py, point contacts
+FullDynamicsSettings getGo2FullDynamicsSettings(RobotHandler handler) {
+  int nv = handler.getModel().nv;
+  int nu = nv - 6;
+
+  FullDynamicsSettings settings;
+  settings.DT = 0.01;
+  settings.w_x = Eigen::MatrixXd::Identity(nv * 2, nv * 2);
+  settings.w_x.diagonal() << 0, 0, 0, 0, 0, 0, // Base pos/ori
+      1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,      // Legs
+      10, 10, 10, 10, 10, 10,                  // Base pos/ori vel
+      0.1, 0.1, 0.1, 0.1, 0.1, 0.1,            // Legs vel
+      0.1, 0.1, 0.1, 0.1, 0.1, 0.1;
+  settings.w_u = Eigen::MatrixXd::Identity(nu, nu) * 1e-4;
+  settings.w_cent = Eigen::MatrixXd::Identity(6, 6);
+  settings.w_cent.diagonal() << 0, 0, 1, 0, 0, 1;
+  settings.gravity << 0, 0, -9.81;
+  settings.force_size = 3;
+  settings.w_forces = Eigen::MatrixXd::Identity(3, 3) * 0.001;
+  settings.w_frame = Eigen::MatrixXd::Identity(3, 3) * 1000;
+  settings.umin = -handler.getModel().effortLimit.tail(nu);
+  settings.umax = handler.getModel().effortLimit.tail(nu);
+  settings.qmin = handler.getModel().lowerPositionLimit.tail(nu);
+  settings.qmax = handler.getModel().upperPositionLimit.tail(nu);
+  settings.mu = 0.8;
+  settings.Lfoot = 0.01;
+  settings.Wfoot = 0.01;
+
+  return settings;
+}
+
+KinodynamicsSettings getKinodynamicsSettings(RobotHandler handler) {
+  int nv = handler.getModel().nv;
+  int nu = nv + 6;
+
+  KinodynamicsSettings settings;
+  settings.DT = 0.01;
+  settings.w_x = Eigen::MatrixXd::Identity(nv * 2, nv * 2);
+  settings.w_x.diagonal() << 0, 0, 1000, 1000, 1000, 1000, // Base pos/ori
+      0.1, 0.1, 0.1, 0.1, 0.1, 0.1,                        // Left leg
+      0.1, 0.1, 0.1, 0.1, 0.1, 0.1,                        // Right leg
+      100, 1000,                                           // Torso
+      10, 10, 10, 10,                                      // Left arm
+      10, 10, 10, 10,                                      // Right arm
+      0.1, 0.1, 0.1, 1000, 1000, 1000,                     // Base pos/ori vel
+      1, 1, 1, 1, 1, 1,                                    // Left leg vel
+      1, 1, 1, 1, 1, 1,                                    // Right leg vel
+      0.1, 100,                                            // Torso vel
+      10, 10, 10, 10,                                      // Left arm vel
+      10, 10, 10, 10;                                      // Right arm vel
+  settings.w_x.diagonal() *= 10;
+  Eigen::VectorXd w_linforce(3);
+  Eigen::VectorXd w_angforce(3);
+  Eigen::VectorXd w_ujoint = Eigen::VectorXd::Ones(nv - 6) * 1e-3;
+  w_linforce << 0.001, 0.001, 0.001;
+  w_angforce << 1, 1, 1;
+  settings.w_u = Eigen::MatrixXd::Identity(nu, nu);
+  settings.w_u.diagonal() << w_linforce, w_angforce, w_linforce, w_angforce,
+      w_ujoint;
+  settings.w_cent = Eigen::MatrixXd::Identity(6, 6);
+  settings.w_cent.diagonal() << 0, 0, 0, 0.1, 0.1, 0.1;
+  settings.w_centder = Eigen::MatrixXd::Identity(6, 6);
+  settings.w_centder.diagonal() << 0.1, 0.1, 0.1, 0.1, 0.1, 0.1;
+  settings.gravity << 0, 0, -9.81;
+  settings.force_size = 6;
+  settings.w_frame = Eigen::MatrixXd::Identity(6, 6) * 50000;
+  settings.qmin =
+      handler.getModel().lowerPositionLimit.tail(handler.getModel().nv - 6);
+  settings.qmax =
+      handler.getModel().upperPositionLimit.tail(handler.getModel().nv - 6);
+  settings.mu = 0.8;
+  settings.Lfoot = 0.1;
+  settings.Wfoot = 0.075;
+
+  return settings;
+}
+
+MPCSettings getMPCSettings(RobotHandler handler, size_t T) {
+  MPCSettings settings;
+  settings.support_force = 9.81 * handler.getMass();
+  settings.TOL = 1e-4;
+  settings.mu_init = 1e-8;
+  settings.max_iters = 1;
+  settings.num_threads = 1;
+  settings.swing_apex = 0.1;
+  settings.T_fly = 80;
+  settings.T_contact = 20;
+  settings.T = T;
+  settings.dt = 0.01;
+
+  return settings;
+}
+
+// Walking cycle: double support, left stance, double support, right stance
+std::vector<std::map<std::string, bool>>
+getWalkingContactStates(RobotHandler handler) {
+  std::vector<std::map<std::string, bool>> contact_states;
+  const std::vector<std::pair<std::size_t, std::pair<bool, bool>>> phases = {
+      {10, {true, true}},
+      {50, {true, false}},
+      {10, {true, true}},
+      {50, {false, true}}};
+  for (auto const &phase : phases) {
+    for (std::size_t i = 0; i < phase.first; i++) {
+      std::map<std::string, bool> contact_state;
+      contact_state.insert({handler.getFootName(0), phase.second.first});
+      contact_state.insert({handler.getFootName(1), phase.second.second});
+      contact_states.push_back(contact_state);
+    }
+  }
+
+  return contact_states;
+}
+
+std::shared_ptr<MPC> getFullDynamicsMPC(RobotHandler handler,
+                                        const MPCSettings &mpc_settings) {
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  problem->createProblem(handler.getState(), mpc_settings.T, 6,
+                         -settings.gravity[2]);
+
+  std::shared_ptr<MPC> mpc = std::make_shared<MPC>(mpc_settings, problem);
+  mpc->generateCycleHorizon(getWalkingContactStates(handler));
+
+  return mpc;
+}
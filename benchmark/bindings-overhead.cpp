@@ -0,0 +1,118 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.cpp"
+
+// Reference timings of the hot-path methods called from the Python control
+// loop. benchmark/bindings_overhead.py runs the same calls through the
+// bindings and subtracts these numbers, so benchmark names must match the
+// ones listed there. Methods that accumulate state run on a fresh MPC whose
+// construction is not timed, as in the Python script.
+
+static void BM_generateCycleHorizon(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  MPCSettings mpc_settings = getMPCSettings(handler, 100);
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  problem->createProblem(handler.getState(), mpc_settings.T, 6,
+                         -settings.gravity[2]);
+  const std::vector<std::map<std::string, bool>> contact_states =
+      getWalkingContactStates(handler);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    MPC mpc(mpc_settings, problem);
+    state.ResumeTiming();
+    mpc.generateCycleHorizon(contact_states);
+  }
+}
+BENCHMARK(BM_generateCycleHorizon)->Unit(benchmark::kMicrosecond);
+
+static void BM_generateCycleHorizonArray(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  MPCSettings mpc_settings = getMPCSettings(handler, 100);
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  problem->createProblem(handler.getState(), mpc_settings.T, 6,
+                         -settings.gravity[2]);
+  const std::vector<std::map<std::string, bool>> contact_states =
+      getWalkingContactStates(handler);
+  MPC::ContactSchedule schedule((long)contact_states.size(), 2);
+  for (std::size_t i = 0; i < contact_states.size(); i++) {
+    schedule((long)i, 0) = contact_states[i].at(handler.getFootName(0));
+    schedule((long)i, 1) = contact_states[i].at(handler.getFootName(1));
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    MPC mpc(mpc_settings, problem);
+    state.ResumeTiming();
+    mpc.generateCycleHorizon(schedule);
+  }
+}
+BENCHMARK(BM_generateCycleHorizonArray)->Unit(benchmark::kMicrosecond);
+
+static void BM_getReferencePose(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  std::shared_ptr<MPC> mpc =
+      getFullDynamicsMPC(handler, getMPCSettings(handler, 100));
+  const std::string foot_name = handler.getFootName(0);
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(mpc->getReferencePose(0, foot_name));
+}
+BENCHMARK(BM_getReferencePose)->Unit(benchmark::kMicrosecond);
+
+static void BM_shapeState(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  const Eigen::VectorXd q = handler.getCompleteConfiguration();
+  const Eigen::VectorXd v =
+      Eigen::VectorXd::Zero(handler.getCompleteModel().nv);
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(handler.shapeState(q, v));
+}
+BENCHMARK(BM_shapeState)->Unit(benchmark::kMicrosecond);
+
+static void BM_difference(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  const Eigen::VectorXd x0 = handler.getState();
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(handler.difference(x0, x0));
+}
+BENCHMARK(BM_difference)->Unit(benchmark::kMicrosecond);
+
+// Python reads mpc.xs as a list of fresh arrays, i.e. one copy per node
+static void BM_xs(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  std::shared_ptr<MPC> mpc =
+      getFullDynamicsMPC(handler, getMPCSettings(handler, 100));
+
+  for (auto _ : state) {
+    std::vector<Eigen::VectorXd> xs = mpc->xs_;
+    benchmark::DoNotOptimize(xs);
+  }
+}
+BENCHMARK(BM_xs)->Unit(benchmark::kMicrosecond);
+
+static void BM_initialize(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  MPCSettings mpc_settings = getMPCSettings(handler, 100);
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  problem->createProblem(handler.getState(), mpc_settings.T, 6,
+                         -settings.gravity[2]);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    MPC mpc;
+    state.ResumeTiming();
+    mpc.initialize(mpc_settings, problem);
+  }
+}
+BENCHMARK(BM_initialize)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,202 @@
+"""
+Per-call overhead of the Python bindings on the control-loop hot path.
+
+Each method is timed through the bindings with the same robot, problem and
+arguments as benchmark/bindings-overhead.cpp. If the path to the bench binary
+is given, its results are read back and the table reports the C++ time and
+the overhead of the bindings, otherwise only the Python times are printed.
+
+    python bindings_overhead.py [path/to/bench-bindings-overhead] [--repeat N]
+
+The output is a markdown table so it can be pasted or diffed in CI logs.
+"""
+
+import argparse
+import json
+import subprocess
+import timeit
+
+import example_robot_data
+import numpy as np
+from simple_mpc import MPC, FullDynamicsProblem, RobotHandler
+
+URDF_SUBPATH = "/talos_data/robots/talos_reduced.urdf"
+SRDF_SUBPATH = "/talos_data/srdf/talos.srdf"
+
+modelPath = example_robot_data.getModelPath(URDF_SUBPATH)
+design_conf = dict(
+    urdf_path=modelPath + URDF_SUBPATH,
+    srdf_path=modelPath + SRDF_SUBPATH,
+    robot_description="",
+    root_name="root_joint",
+    base_configuration="half_sitting",
+    controlled_joints_names=[
+        "root_joint",
+        "leg_left_1_joint",
+        "leg_left_2_joint",
+        "leg_left_3_joint",
+        "leg_left_4_joint",
+        "leg_left_5_joint",
+        "leg_left_6_joint",
+        "leg_right_1_joint",
+        "leg_right_2_joint",
+        "leg_right_3_joint",
+        "leg_right_4_joint",
+        "leg_right_5_joint",
+        "leg_right_6_joint",
+        "torso_1_joint",
+        "torso_2_joint",
+        "arm_left_1_joint",
+        "arm_left_2_joint",
+        "arm_left_3_joint",
+        "arm_left_4_joint",
+        "arm_right_1_joint",
+        "arm_right_2_joint",
+        "arm_right_3_joint",
+        "arm_right_4_joint",
+    ],
+    end_effector_names=[
+        "left_sole_link",
+        "right_sole_link",
+    ],
+)
+handler = RobotHandler()
+handler.initialize(design_conf)
+nv = handler.getModel().nv
+nu = nv - 6
+
+# Same settings as benchmark/bench_utils.cpp
+w_x = np.array(
+    [0, 0, 0, 100, 100, 100]
+    + [0.1] * 12
+    + [10, 10]
+    + [1] * 8
+    + [1] * 6
+    + [0.1, 0.1, 0.1, 0.1, 0.01, 0.01] * 2
+    + [10, 10]
+    + [1] * 8
+)
+gravity = np.array([0, 0, -9.81])
+problem_conf = dict(
+    DT=0.01,
+    w_x=np.diag(w_x),
+    w_u=np.eye(nu) * 1e-4,
+    w_cent=np.diag([0, 0, 10, 0, 0, 10]),
+    gravity=gravity,
+    force_size=6,
+    w_forces=np.eye(6) * 0.0001,
+    w_frame=np.eye(6) * 2000,
+    umin=-handler.getModel().effortLimit[6:],
+    umax=handler.getModel().effortLimit[6:],
+    qmin=handler.getModel().lowerPositionLimit[7:],
+    qmax=handler.getModel().upperPositionLimit[7:],
+    mu=0.8,
+    Lfoot=0.1,
+    Wfoot=0.075,
+)
+T = 100
+mpc_conf = dict(
+    ddpIteration=1,
+    support_force=-handler.getMass() * gravity[2],
+    TOL=1e-4,
+    mu_init=1e-8,
+    max_iters=1,
+    num_threads=1,
+    swing_apex=0.1,
+    T_fly=80,
+    T_contact=20,
+    T=T,
+    dt=0.01,
+)
+
+# Walking cycle: double support, left stance, double support, right stance
+feet = handler.getFeetNames()
+contact_phases = [{feet[0]: True, feet[1]: True}] * 10
+contact_phases += [{feet[0]: True, feet[1]: False}] * 50
+contact_phases += [{feet[0]: True, feet[1]: True}] * 10
+contact_phases += [{feet[0]: False, feet[1]: True}] * 50
+contact_schedule = np.array(
+    [[phase[foot] for foot in feet] for phase in contact_phases], dtype=bool
+)
+
+dynproblem = FullDynamicsProblem(handler)
+dynproblem.initialize(problem_conf)
+dynproblem.createProblem(handler.getState(), T, 6, gravity[2])
+
+
+def new_mpc():
+    mpc = MPC()
+    mpc.initialize(mpc_conf, dynproblem)
+    return mpc
+
+
+walking_mpc = new_mpc()
+walking_mpc.generateCycleHorizon(contact_phases)
+q_complete = handler.getCompleteConfiguration()
+v_complete = np.zeros(handler.getCompleteModel().nv)
+x0 = handler.getState()
+
+# name: (statement, setup). The setup runs before every timed call and is not
+# measured; it is only used by the methods that accumulate state.
+CASES = {
+    "generateCycleHorizon": (
+        "mpc.generateCycleHorizon(contact_phases)",
+        "mpc = new_mpc()",
+    ),
+    "generateCycleHorizonArray": (
+        "mpc.generateCycleHorizon(contact_schedule)",
+        "mpc = new_mpc()",
+    ),
+    "getReferencePose": ("walking_mpc.getReferencePose(0, feet[0])", None),
+    "shapeState": ("handler.shapeState(q_complete, v_complete)", None),
+    "difference": ("handler.difference(x0, x0)", None),
+    "xs": ("walking_mpc.xs", None),
+    "initialize": ("mpc.initialize(mpc_conf, dynproblem)", "mpc = MPC()"),
+}
+
+
+def time_python(stmt, setup, repeat):
+    """Median time of one call in microseconds."""
+    if setup is None:
+        number = 100
+        times = timeit.repeat(stmt, number=number, repeat=repeat, globals=globals())
+    else:
+        number = 1
+        times = timeit.repeat(
+            stmt, setup=setup, number=number, repeat=repeat, globals=globals()
+        )
+    return float(np.median(times)) / number * 1e6
+
+
+def time_cpp(bench_path):
+    """Per-call time of each C++ benchmark in microseconds."""
+    out = subprocess.run(
+        [bench_path, "--benchmark_format=json"],
+        check=True,
+        capture_output=True,
+        text=True,
+    ).stdout
+    scale = {"ns": 1e-3, "us": 1.0, "ms": 1e3, "s": 1e6}
+    timings = {}
+    for bench in json.loads(out)["benchmarks"]:
+        name = bench["name"].split("/")[0]
+        if name.startswith("BM_"):
+            timings[name[3:]] = bench["real_time"] * scale[bench["time_unit"]]
+    return timings
+
+
+parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+parser.add_argument("bench", nargs="?", help="path to bench-bindings-overhead")
+parser.add_argument("--repeat", type=int, default=20)
+args = parser.parse_args()
+
+cpp = time_cpp(args.bench) if args.bench else {}
+
+print("| method | python [us] | c++ [us] | overhead [us] |")
+print("|---|---:|---:|---:|")
+for name, (stmt, setup) in CASES.items():
+    py = time_python(stmt, setup, args.repeat)
+    if name in cpp:
+        print(f"| {name} | {py:.2f} | {cpp[name]:.2f} | {py - cpp[name]:.2f} |")
+    else:
+        print(f"| {name} | {py:.2f} | - | - |")
@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.cpp"
+
+// Building the cycle horizon on a gait switch, with the walking cycle
+// alternated with a slower one, and one MPC tick once it is in place.
+static void BM_gaitSwitch(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  std::shared_ptr<MPC> mpc =
+      getFullDynamicsMPC(handler, getMPCSettings(handler, 100));
+
+  std::vector<std::map<std::string, bool>> walk =
+      getWalkingContactStates(handler);
+  std::vector<std::map<std::string, bool>> slow_walk;
+  for (auto const &contact_state : walk) {
+    slow_walk.push_back(contact_state);
+    slow_walk.push_back(contact_state);
+  }
+
+  bool slow = false;
+  for (auto _ : state) {
+    mpc->generateCycleHorizon(slow ? slow_walk : walk);
+    slow = !slow;
+  }
+  state.counters["stages"] = (double)mpc->getCycleHorizon().size();
+}
+BENCHMARK(BM_gaitSwitch)->Unit(benchmark::kMillisecond);
+
+static void BM_iterate(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  std::shared_ptr<MPC> mpc =
+      getFullDynamicsMPC(handler, getMPCSettings(handler, 100));
+
+  for (auto _ : state)
+    mpc->iterate(q, v);
+}
+BENCHMARK(BM_iterate)->Unit(benchmark::kMillisecond);
+
+// One recede drawing its stage from a queued contact plan of alternating
+// footsteps, against one recede along the walking cycle. Footsteps are
+// queued outside the timing.
+static void BM_recede(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  std::shared_ptr<MPC> mpc =
+      getFullDynamicsMPC(handler, getMPCSettings(handler, 100));
+  const bool plan = state.range(0) == 1;
+
+  std::size_t step = 0;
+  for (auto _ : state) {
+    if (plan and mpc->getContactPlanSize() == 0) {
+      state.PauseTiming();
+      mpc->appendFootsteps({handler.getFootName(step % 2)}, 50, 10);
+      step++;
+      state.ResumeTiming();
+    }
+    mpc->recedeWithCycle();
+  }
+}
+BENCHMARK(BM_recede)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,45 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.cpp"
+#include "simple-mpc/lowlevel-batch.hpp"
+
+// Throughput of the batched ID solver; the items_per_second column is the
+// number of QPs solved per second
+static void BM_IDBatch(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  std::size_t batch_size = (std::size_t)state.range(0);
+  int num_threads = (int)state.range(1);
+
+  IDSettings settings;
+  settings.contact_ids = handler.getFeetIds();
+  settings.mu = 0.8;
+  settings.Lfoot = 0.1;
+  settings.Wfoot = 0.075;
+  settings.force_size = 6;
+  settings.kd = 10;
+  settings.w_force = 1000;
+  settings.w_acc = 1;
+  settings.verbose = false;
+  IDBatchSolver solver(settings, handler.getModel(), batch_size, num_threads);
+
+  long nv = handler.getModel().nv;
+  Eigen::MatrixXd v = Eigen::MatrixXd::Random(nv, (long)batch_size);
+  Eigen::MatrixXd a = Eigen::MatrixXd::Random(nv, (long)batch_size);
+  Eigen::MatrixXd forces = Eigen::MatrixXd::Zero(12, (long)batch_size);
+  forces.row(2).setConstant(handler.getMass() * 9.81 / 2);
+  forces.row(8).setConstant(handler.getMass() * 9.81 / 2);
+  std::vector<pinocchio::Data> datas(batch_size, handler.getData());
+  std::vector<std::vector<bool>> contact_states(batch_size, {true, true});
+
+  for (auto _ : state) {
+    solver.solve(datas, contact_states, v, a, forces);
+    benchmark::DoNotOptimize(solver.solved_torque_.data());
+  }
+  state.SetItemsProcessed(state.iterations() * (int64_t)batch_size);
+}
+BENCHMARK(BM_IDBatch)
+    ->ArgsProduct({{1, 64, 256}, {1, 2, 4, 8}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
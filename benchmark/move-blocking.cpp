@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.cpp"
+
+// Compare one MPC tick on the fully parameterised horizon with a shorter
+// horizon whose tail stages are blocked so that both cover the same time.
+// The u0_error counter is the mean distance between the first control of
+// the blocked plan and the one of the full plan computed from the same
+// state, i.e. the loss on what is actually sent to the robot. With the
+// third argument set both walk, so that blocked stages change contacts
+// as the gait goes by.
+static void BM_iterate(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+
+  MPCSettings full_settings = getMPCSettings(handler, 100);
+  std::shared_ptr<MPC> full_mpc = getFullDynamicsMPC(handler, full_settings);
+
+  std::size_t blocking_start = (std::size_t)state.range(0);
+  std::size_t blocking_factor = (std::size_t)state.range(1);
+  MPCSettings mpc_settings = getMPCSettings(
+      handler, blocking_start + (100 - blocking_start) / blocking_factor);
+  mpc_settings.blocking_start = blocking_start;
+  mpc_settings.blocking_factor = blocking_factor;
+  std::shared_ptr<MPC> mpc = getFullDynamicsMPC(handler, mpc_settings);
+  if (state.range(2) == 1) {
+    const Eigen::VectorXd velocity = Eigen::VectorXd::Zero(6);
+    full_mpc->switchToWalk(velocity);
+    mpc->switchToWalk(velocity);
+  }
+
+  double u0_error = 0;
+  for (auto _ : state) {
+    mpc->iterate(q, v);
+
+    state.PauseTiming();
+    full_mpc->iterate(q, v);
+    u0_error += (mpc->us_[0] - full_mpc->us_[0]).norm();
+    state.ResumeTiming();
+  }
+  state.counters["T"] = (double)mpc->getProblem()->getSize();
+  state.counters["u0_error"] =
+      benchmark::Counter(u0_error, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_iterate)
+    ->Args({100, 1, 0})
+    ->Args({50, 2, 0})
+    ->Args({40, 3, 0})
+    ->Args({20, 4, 0})
+    ->Args({100, 1, 1})
+    ->Args({50, 2, 1})
+    ->Args({40, 3, 1})
+    ->Args({20, 4, 1})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
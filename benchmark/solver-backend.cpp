@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.cpp"
+
+// Solver backends on the Talos walking MPC: ProxDDP (0), FDDP (1) and the
+// automatic choice (2). FDDP ignores the constraints of the stages, so the
+// cost and primal infeasibility counters tell what it gives up.
+static std::shared_ptr<MPC> getMPC(RobotHandler handler, const bool kino,
+                                   const SolverBackend backend) {
+  MPCSettings mpc_settings = getMPCSettings(handler, 100);
+  mpc_settings.solver_backend = backend;
+  mpc_settings.verbose = false;
+  std::shared_ptr<Problem> problem;
+  if (kino) {
+    KinodynamicsSettings settings = getKinodynamicsSettings(handler);
+    problem = std::make_shared<KinodynamicsProblem>(settings, handler);
+  } else {
+    FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+    problem = std::make_shared<FullDynamicsProblem>(settings, handler);
+  }
+  problem->createProblem(handler.getState(), mpc_settings.T, 6, 9.81);
+
+  std::shared_ptr<MPC> mpc = std::make_shared<MPC>(mpc_settings, problem);
+  mpc->generateCycleHorizon(getWalkingContactStates(handler));
+  return mpc;
+}
+
+// One walking tick, at the single iteration of the MPC loop
+static void benchIterate(benchmark::State &state, const bool kino) {
+  RobotHandler handler = getTalosHandler();
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  std::shared_ptr<MPC> mpc =
+      getMPC(handler, kino, (SolverBackend)state.range(0));
+
+  double cost = 0;
+  double prim_infeas = 0;
+  for (auto _ : state) {
+    mpc->iterate(q, v);
+
+    state.PauseTiming();
+    cost += mpc->getOCPSolver().getResults().traj_cost_;
+    prim_infeas += mpc->getOCPSolver().getResults().prim_infeas;
+    state.ResumeTiming();
+  }
+  state.counters["cost"] =
+      benchmark::Counter(cost, benchmark::Counter::kAvgIterations);
+  state.counters["prim_infeas"] =
+      benchmark::Counter(prim_infeas, benchmark::Counter::kAvgIterations);
+  state.counters["backend"] = (double)mpc->getSolverBackend();
+}
+
+// Cold start solved to convergence, as in MPC::reset
+static void benchConverge(benchmark::State &state, const bool kino) {
+  RobotHandler handler = getTalosHandler();
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  std::shared_ptr<MPC> mpc =
+      getMPC(handler, kino, (SolverBackend)state.range(0));
+
+  double iterations = 0;
+  double converged = 0;
+  for (auto _ : state) {
+    mpc->reset(q, v);
+
+    state.PauseTiming();
+    iterations += (double)mpc->getOCPSolver().getResults().num_iters;
+    converged += mpc->getOCPSolver().getResults().conv ? 1. : 0.;
+    state.ResumeTiming();
+  }
+  state.counters["iterations"] =
+      benchmark::Counter(iterations, benchmark::Counter::kAvgIterations);
+  state.counters["converged"] =
+      benchmark::Counter(converged, benchmark::Counter::kAvgIterations);
+}
+
+static void BM_iterate_fulldynamics(benchmark::State &state) {
+  benchIterate(state, false);
+}
+BENCHMARK(BM_iterate_fulldynamics)
+    ->Arg(SOLVER_PROXDDP)
+    ->Arg(SOLVER_FDDP)
+    ->Arg(SOLVER_AUTO)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_iterate_kinodynamics(benchmark::State &state) {
+  benchIterate(state, true);
+}
+BENCHMARK(BM_iterate_kinodynamics)
+    ->Arg(SOLVER_PROXDDP)
+    ->Arg(SOLVER_FDDP)
+    ->Arg(SOLVER_AUTO)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_converge_fulldynamics(benchmark::State &state) {
+  benchConverge(state, false);
+}
+BENCHMARK(BM_converge_fulldynamics)
+    ->Arg(SOLVER_PROXDDP)
+    ->Arg(SOLVER_FDDP)
+    ->Unit(benchmark::kMillisecond);
+
+static void BM_converge_kinodynamics(benchmark::State &state) {
+  benchConverge(state, true);
+}
+BENCHMARK(BM_converge_kinodynamics)
+    ->Arg(SOLVER_PROXDDP)
+    ->Arg(SOLVER_FDDP)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.cpp"
+
+// Evaluation and first-order derivatives of one full dynamics stage with
+// every foot in stance, with the placement costs of the stance feet (0) or
+// without them (1). Talos has two 6D contacts and Go2 four 3D contacts.
+// num_costs is the number of cost components of the stage.
+static void benchStage(benchmark::State &state, const RobotHandler &handler,
+                       FullDynamicsSettings settings) {
+  settings.prune_stance_costs = state.range(0) == 1;
+  FullDynamicsProblem problem(settings, handler);
+
+  std::map<std::string, bool> contact_phase;
+  std::map<std::string, bool> land_constraint;
+  std::map<std::string, pinocchio::SE3> contact_pose;
+  std::map<std::string, Eigen::VectorXd> contact_force;
+  Eigen::VectorXd force_ref = Eigen::VectorXd::Zero(settings.force_size);
+  force_ref[2] = -settings.gravity[2] * handler.getMass() /
+                 (double)handler.getFeetNames().size();
+  for (auto const &name : handler.getFeetNames()) {
+    contact_phase.insert({name, true});
+    land_constraint.insert({name, false});
+    contact_pose.insert({name, handler.getFootPose(name)});
+    contact_force.insert({name, force_ref});
+  }
+  StageModel sm = problem.createStage(contact_phase, contact_pose,
+                                      contact_force, land_constraint);
+  std::shared_ptr<StageData> data = sm.createData();
+
+  const Eigen::VectorXd x = handler.getState();
+  const Eigen::VectorXd u = Eigen::VectorXd::Zero(sm.nu());
+  for (auto _ : state) {
+    sm.evaluate(x, u, x, *data);
+    sm.computeFirstOrderDerivatives(x, u, x, *data);
+  }
+  state.counters["num_costs"] =
+      (double)dynamic_cast<CostStack *>(&*sm.cost_)->components_.size();
+}
+
+static void BM_talos(benchmark::State &state) {
+  RobotHandler handler = getTalosHandler();
+  benchStage(state, handler, getFullDynamicsSettings(handler));
+}
+BENCHMARK(BM_talos)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+static void BM_go2(benchmark::State &state) {
+  RobotHandler handler = getGo2Handler();
+  benchStage(state, handler, getGo2FullDynamicsSettings(handler));
+}
+BENCHMARK(BM_go2)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
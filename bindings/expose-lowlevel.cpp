@@ -29,8 +29,7 @@ inline void py_list_to_std_vector(const bp::object &iterable,
                        boost::python::stl_input_iterator<T>());
 }
 
-void initialize_ID(IDSolver &self, const bp::dict &settings,
-                   const pinocchio::Model &model) {
+IDSettings extract_ID_settings(const bp::dict &settings) {
   IDSettings conf;
 
   py_list_to_std_vector(settings["contact_ids"], conf.contact_ids);
@@ -44,12 +43,33 @@ void initialize_ID(IDSolver &self, const bp::dict &settings,
   conf.w_force = bp::extract<double>(settings["w_force"]);
   conf.w_acc = bp::extract<double>(settings["w_acc"]);
   conf.verbose = bp::extract<bool>(settings["verbose"]);
+  if (settings.has_key("closed_form"))
+    conf.closed_form = bp::extract<bool>(settings["closed_form"]);
 
-  self.initialize(conf, model);
+  return conf;
 }
 
-void initialize_IKID(IKIDSolver &self, const bp::dict &settings,
-                     const pinocchio::Model &model) {
+void initialize_ID(IDSolver &self, const bp::dict &settings,
+                   const pinocchio::Model &model) {
+  self.initialize(extract_ID_settings(settings), model);
+}
+
+// Shares the reduced model of the handler instead of copying it
+void initialize_ID_from_handler(IDSolver &self, const bp::dict &settings,
+                                RobotHandler &handler) {
+  self.initialize(extract_ID_settings(settings), handler.getModelHandle());
+}
+
+void update_ID_model(IDSolver &self, RobotHandler &handler) {
+  self.updateModel(handler.getModelHandle());
+}
+
+// The solver shares the ownership of the handler cache
+void use_ID_kinematics(IDSolver &self, RobotHandler &handler) {
+  self.useFrameKinematics(handler.getFrameKinematicsHandle());
+}
+
+IKIDSettings extract_IKID_settings(const bp::dict &settings) {
   IKIDSettings conf;
 
   py_list_to_std_vector(settings["Kp_gains"], conf.Kp_gains);
@@ -71,7 +91,25 @@ void initialize_IKID(IKIDSolver &self, const bp::dict &settings,
   conf.w_force = bp::extract<double>(settings["w_force"]);
   conf.verbose = bp::extract<bool>(settings["verbose"]);
 
-  self.initialize(conf, model);
+  return conf;
+}
+
+void initialize_IKID(IKIDSolver &self, const bp::dict &settings,
+                     const pinocchio::Model &model) {
+  self.initialize(extract_IKID_settings(settings), model);
+}
+
+void initialize_IKID_from_handler(IKIDSolver &self, const bp::dict &settings,
+                                  RobotHandler &handler) {
+  self.initialize(extract_IKID_settings(settings), handler.getModelHandle());
+}
+
+void update_IKID_model(IKIDSolver &self, RobotHandler &handler) {
+  self.updateModel(handler.getModelHandle());
+}
+
+void use_IKID_kinematics(IKIDSolver &self, RobotHandler &handler) {
+  self.useFrameKinematics(handler.getFrameKinematicsHandle());
 }
 
 void exposeIDSolver() {
@@ -82,6 +120,8 @@ void exposeIDSolver() {
   bp::class_<IDSolver>("IDSolver", bp::no_init)
       .def(bp::init<>(bp::args("self")))
       .def("initialize", &initialize_ID)
+      .def("initialize", &initialize_ID_from_handler)
+      .def("updateModel", &update_ID_model, bp::args("self", "handler"))
       .def("solve_qp", &IDSolver::solve_qp,
            bp::args("self", "data", "contact_state", "v", "a", "forces", "M"))
       .def("getA", &IDSolver::getA, bp::args("self"))
@@ -90,6 +130,10 @@ void exposeIDSolver() {
       .def("getC", &IDSolver::getC, bp::args("self"))
       .def("getb", &IDSolver::getb, bp::args("self"))
       .def("getg", &IDSolver::getg, bp::args("self"))
+      .def("useFrameKinematics", &use_ID_kinematics,
+           bp::args("self", "handler"))
+      .def("getClosedFormRate", &IDSolver::getClosedFormRate, bp::args("self"))
+      .def("getSolveTime", &IDSolver::getSolveTime, bp::args("self"))
       //.def("getQP",
       //     bp::make_function(
       //         &IDSolver::getQP,
@@ -108,10 +152,14 @@ void exposeIKIDSolver() {
   bp::class_<IKIDSolver>("IKIDSolver", bp::no_init)
       .def(bp::init<>(bp::args("self")))
       .def("initialize", &initialize_IKID)
+      .def("initialize", &initialize_IKID_from_handler)
+      .def("updateModel", &update_IKID_model, bp::args("self", "handler"))
       .def("solve_qp", &IKIDSolver::solve_qp,
            bp::args("self", "data", "contact_state", "x_measured", "forces",
                     "dH", "M"))
       .def("getQP", &IKIDSolver::getQP, bp::args("self"))
+      .def("useFrameKinematics", &use_IKID_kinematics,
+           bp::args("self", "handler"))
       .def(
           "computeDifferences", &IKIDSolver::computeDifferences,
           bp::args("self", "data", "x_measured", "foot_refs", "foot_refs_next"))
@@ -35,6 +35,9 @@ void initialize(MPC &self, const bp::dict &settings,
   conf.mu_init = bp::extract<double>(settings["mu_init"]);
   conf.max_iters = bp::extract<std::size_t>(settings["max_iters"]);
   conf.num_threads = bp::extract<std::size_t>(settings["num_threads"]);
+  if (settings.has_key("solver_backend"))
+    conf.solver_backend =
+        bp::extract<SolverBackend>(settings["solver_backend"]);
 
   conf.swing_apex = bp::extract<double>(settings["swing_apex"]);
   conf.T_fly = bp::extract<int>(settings["T_fly"]);
@@ -42,6 +45,33 @@ void initialize(MPC &self, const bp::dict &settings,
   conf.T = bp::extract<std::size_t>(settings["T"]);
   conf.dt = bp::extract<double>(settings["dt"]);
 
+  // Optional solution health checks
+  if (settings.has_key("max_cost_ratio"))
+    conf.max_cost_ratio = bp::extract<double>(settings["max_cost_ratio"]);
+  if (settings.has_key("max_prim_infeas"))
+    conf.max_prim_infeas = bp::extract<double>(settings["max_prim_infeas"]);
+
+  // Optional move blocking
+  if (settings.has_key("blocking_start"))
+    conf.blocking_start = bp::extract<std::size_t>(settings["blocking_start"]);
+  if (settings.has_key("blocking_factor"))
+    conf.blocking_factor =
+        bp::extract<std::size_t>(settings["blocking_factor"]);
+
+  // Optional solve skipping
+  if (settings.has_key("skip_state_tol"))
+    conf.skip_state_tol = bp::extract<double>(settings["skip_state_tol"]);
+  if (settings.has_key("skip_reference_tol"))
+    conf.skip_reference_tol =
+        bp::extract<double>(settings["skip_reference_tol"]);
+  if (settings.has_key("max_skipped_solves"))
+    conf.max_skipped_solves =
+        bp::extract<std::size_t>(settings["max_skipped_solves"]);
+  if (settings.has_key("predict_command"))
+    conf.predict_command = bp::extract<bool>(settings["predict_command"]);
+  if (settings.has_key("verbose"))
+    conf.verbose = bp::extract<bool>(settings["verbose"]);
+
   self.initialize(conf, problem);
 }
 
@@ -54,11 +84,21 @@ bp::dict getSettings(MPC &self) {
   settings["mu_init"] = conf.mu_init;
   settings["max_iters"] = conf.max_iters;
   settings["num_threads"] = conf.num_threads;
+  settings["solver_backend"] = conf.solver_backend;
   settings["swing_apex"] = conf.swing_apex;
   settings["T_fly"] = conf.T_fly;
   settings["T_contact"] = conf.T_contact;
   settings["T"] = conf.T;
   settings["dt"] = conf.dt;
+  settings["max_cost_ratio"] = conf.max_cost_ratio;
+  settings["max_prim_infeas"] = conf.max_prim_infeas;
+  settings["blocking_start"] = conf.blocking_start;
+  settings["blocking_factor"] = conf.blocking_factor;
+  settings["skip_state_tol"] = conf.skip_state_tol;
+  settings["skip_reference_tol"] = conf.skip_reference_tol;
+  settings["max_skipped_solves"] = conf.max_skipped_solves;
+  settings["predict_command"] = conf.predict_command;
+  settings["verbose"] = conf.verbose;
 
   return settings;
 }
@@ -76,25 +116,107 @@ void exposeMPC() {
       true>::expose("StdMap_Bool");
 
   StdVectorPythonVisitor<std::vector<MapBool>, true>::expose("StdVec_MapBool");
+  eigenpy::enableEigenPySpecific<MPC::ContactSchedule>();
+
+  void (MPC::*generate_from_maps)(const std::vector<MapBool> &) =
+      &MPC::generateCycleHorizon;
+  void (MPC::*generate_from_schedule)(
+      const Eigen::Ref<const MPC::ContactSchedule> &) =
+      &MPC::generateCycleHorizon;
+  void (MPC::*append_from_maps)(const std::vector<MapBool> &) =
+      &MPC::appendContactPlan;
+  void (MPC::*append_from_schedule)(
+      const Eigen::Ref<const MPC::ContactSchedule> &) = &MPC::appendContactPlan;
+  void (MPC::*iterate_node)(const Eigen::VectorXd &, const Eigen::VectorXd &) =
+      &MPC::iterate;
+  void (MPC::*iterate_timed)(const Eigen::VectorXd &, const Eigen::VectorXd &,
+                             const double) = &MPC::iterate;
+
+  bp::enum_<MPC::SolutionStatus>("SolutionStatus")
+      .value("SOLUTION_OK", MPC::SOLUTION_OK)
+      .value("SOLUTION_NOT_FINITE", MPC::SOLUTION_NOT_FINITE)
+      .value("SOLUTION_COST_JUMP", MPC::SOLUTION_COST_JUMP)
+      .value("SOLUTION_INFEASIBLE", MPC::SOLUTION_INFEASIBLE);
+
+  bp::enum_<SolverBackend>("SolverBackend")
+      .value("SOLVER_PROXDDP", SOLVER_PROXDDP)
+      .value("SOLVER_FDDP", SOLVER_FDDP)
+      .value("SOLVER_AUTO", SOLVER_AUTO);
 
   bp::class_<MPC>("MPC", bp::no_init)
       .def(bp::init<>(bp::args("self")))
       .def("initialize", &initialize)
       .def("getSettings", &getSettings)
-      .def("generateCycleHorizon", &MPC::generateCycleHorizon,
+      .def("generateCycleHorizon", generate_from_maps,
+           bp::args("self", "contact_states"))
+      .def("generateCycleHorizon", generate_from_schedule,
+           bp::args("self", "contact_schedule"),
+           "Generate the cycle from a boolean array with one row per node "
+           "and one column per foot, in the order of getFeetNames().")
+      .def("appendContactPlan", append_from_maps,
            bp::args("self", "contact_states"))
-      .def("iterate", &MPC::iterate, bp::args("self", "q_current", "v_current"))
+      .def("appendContactPlan", append_from_schedule,
+           bp::args("self", "contact_schedule"),
+           "Queue contact plan nodes from a boolean array with one row per "
+           "node and one column per foot, in the order of getFeetNames().")
+      .def("appendFootsteps", &MPC::appendFootsteps,
+           bp::args("self", "ee_names", "swing_nodes", "support_nodes"))
+      .def("clearContactPlan", &MPC::clearContactPlan, bp::args("self"))
+      .def("getContactPlanSize", &MPC::getContactPlanSize, bp::args("self"))
+      .def("addModelVariant", &MPC::addModelVariant,
+           bp::args("self", "name", "problem"))
+      .def("switchModelVariant", &MPC::switchModelVariant,
+           bp::args("self", "name"))
+      .def("getModelVariant", &MPC::getModelVariant, bp::args("self"),
+           bp::return_value_policy<bp::copy_const_reference>())
+      .def("reset", &MPC::reset, bp::args("self", "q_current", "v_current"))
+      .def("iterate", iterate_node, bp::args("self", "q_current", "v_current"))
+      .def("iterate", iterate_timed,
+           bp::args("self", "q_current", "v_current", "t_now"),
+           "Recede by the time elapsed since the previous timed call.")
       .def("setReferencePose", &MPC::setReferencePose,
            bp::args("self", "t", "ee_name", "pose_ref"))
       .def("getReferencePose", &MPC::getReferencePose,
            bp::args("self", "t", "ee_name"))
       .def("setTerminalReferencePose", &MPC::setTerminalReferencePose,
            bp::args("self", "ee_name", "pose_ref"))
+      .def("setHorizonLength", &MPC::setHorizonLength, bp::args("self", "T"))
+      .def("getStageNode", &MPC::getStageNode, bp::args("self", "t"))
+      .def("getHorizonNodes", &MPC::getHorizonNodes, bp::args("self"))
+      .def("setCostWeights", &MPC::setCostWeights,
+           bp::args("self", "cost_name", "weights"))
+      .def("setLinkInertia", &MPC::setLinkInertia,
+           bp::args("self", "joint_name", "inertia"))
+      .def("setMass", &MPC::setMass, bp::args("self", "mass"))
+      .def("updateInertias", &MPC::updateInertias, bp::args("self"))
       .def("setVelocityBase", &MPC::setVelocityBase,
            bp::args("self", "velocity_base"))
+      .def("predictCommandChange", &MPC::predictCommandChange,
+           bp::args("self", "shift"))
       .def("switchToWalk", &MPC::switchToWalk,
            bp::args("self", "velocity_base"))
       .def("switchToStand", &MPC::switchToStand, bp::args("self"))
+      .def("getSolutionStatus", &MPC::getSolutionStatus, bp::args("self"))
+      .def("getFullControl", &MPC::getFullControl, bp::args("self", "t"),
+           "Control of stage t with the forces of every foot.")
+      .def("getFullFeedback", &MPC::getFullFeedback, bp::args("self"),
+           "Feedback gain of the first stage with the forces of every foot.")
+      .def("getSolverBackend", &MPC::getSolverBackend, bp::args("self"),
+           "Backend of the last solve.")
+      .def("getRejectedSolutions", &MPC::getRejectedSolutions,
+           bp::args("self"))
+      .def("prepareRealTime", &MPC::prepareRealTime,
+           bp::args("self", "q_current", "v_current"))
+      .def("getHotPathAllocations", &MPC::getHotPathAllocations,
+           bp::args("self"))
+      .def("getTickAllocations", &MPC::getTickAllocations, bp::args("self"))
+      .def("getTickRecedeAllocations", &MPC::getTickRecedeAllocations,
+           bp::args("self"))
+      .def("isSolveSkipped", &MPC::isSolveSkipped, bp::args("self"))
+      .def("getSkippedSolves", &MPC::getSkippedSolves, bp::args("self"))
+      .def("getSkipRate", &MPC::getSkipRate, bp::args("self"))
+      .def("getSavedSolveTime", &MPC::getSavedSolveTime, bp::args("self"))
+      .def("getNodePhase", &MPC::getNodePhase, bp::args("self"))
       .def("getFootTakeoffCycle", &MPC::getFootTakeoffCycle,
            bp::args("self", "ee_name"))
       .def("getFootLandCycle", &MPC::getFootLandCycle,
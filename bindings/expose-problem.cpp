@@ -70,6 +70,14 @@ void exposeBaseProblem() {
            bp::args("self", "t", "u_ref"))
       .def("getReferenceControl", &Problem::getReferenceControl,
            bp::args("self", "t"))
+      .def("setCostWeights", &Problem::setCostWeights,
+           bp::args("self", "cost_name", "weights"))
+      .def("getFullControl", &Problem::getFullControl,
+           bp::args("self", "t", "u"),
+           "Control of stage t with the forces of every foot.")
+      .def("updateInertias", &Problem::updateInertias,
+           bp::args("self", "force_scale"),
+           "Propagate a change of the handler model inertias to the stages.")
       .def("getProblem", &Problem::getProblem, bp::args("self"));
 }
 
@@ -95,6 +103,11 @@ void initializeFull(FullDynamicsProblem &self, const bp::dict &settings) {
   conf.qmin = bp::extract<Eigen::VectorXd>(settings["qmin"]);
   conf.qmax = bp::extract<Eigen::VectorXd>(settings["qmax"]);
 
+  // Optional stance cost pruning
+  if (settings.has_key("prune_stance_costs"))
+    conf.prune_stance_costs =
+        bp::extract<bool>(settings["prune_stance_costs"]);
+
   self.initialize(conf);
 }
 
@@ -166,6 +179,7 @@ bp::dict getSettingsFull(FullDynamicsProblem &self) {
   settings["mu"] = conf.mu;
   settings["Lfoot"] = conf.Lfoot;
   settings["Wfoot"] = conf.Wfoot;
+  settings["prune_stance_costs"] = conf.prune_stance_costs;
 
   return settings;
 }
@@ -423,6 +437,11 @@ void initializeKino(KinodynamicsProblem &self, const bp::dict &settings) {
   conf.Lfoot = bp::extract<double>(settings["Lfoot"]);
   conf.Wfoot = bp::extract<double>(settings["Wfoot"]);
 
+  // Optional reduced controls
+  if (settings.has_key("active_forces_only"))
+    conf.active_forces_only =
+        bp::extract<bool>(settings["active_forces_only"]);
+
   self.initialize(conf);
 }
 
@@ -442,6 +461,7 @@ bp::dict getSettingsKino(KinodynamicsProblem &self) {
   settings["mu"] = conf.mu;
   settings["Lfoot"] = conf.Lfoot;
   settings["Wfoot"] = conf.Wfoot;
+  settings["active_forces_only"] = conf.active_forces_only;
 
   return settings;
 }
@@ -55,7 +55,38 @@ bp::dict getSettings(RobotHandler &self) {
   return settings;
 }
 
+// The snapshot is handed to the solvers through updateModel
+void publishModel(RobotHandler &self) { self.publishModel(); }
+
 void exposeHandler() {
+  bp::class_<FrameKinematicsCache>("FrameKinematicsCache", bp::no_init)
+      .def("getSlot", &FrameKinematicsCache::getSlot,
+           bp::args("self", "frame_id"))
+      .def("getVelocity",
+           bp::make_function(
+               &FrameKinematicsCache::getVelocity,
+               bp::return_value_policy<bp::copy_const_reference>()))
+      .def("getJacobian",
+           bp::make_function(
+               &FrameKinematicsCache::getJacobian,
+               bp::return_value_policy<bp::copy_const_reference>()))
+      .def("getJacobianTimeVariation",
+           bp::make_function(
+               &FrameKinematicsCache::getJacobianTimeVariation,
+               bp::return_value_policy<bp::copy_const_reference>()))
+      .def("getVelocityWorldAligned",
+           bp::make_function(
+               &FrameKinematicsCache::getVelocityWorldAligned,
+               bp::return_value_policy<bp::copy_const_reference>()))
+      .def("getJacobianWorldAligned",
+           bp::make_function(
+               &FrameKinematicsCache::getJacobianWorldAligned,
+               bp::return_value_policy<bp::copy_const_reference>()))
+      .def("getJacobianTimeVariationWorldAligned",
+           bp::make_function(
+               &FrameKinematicsCache::getJacobianTimeVariationWorldAligned,
+               bp::return_value_policy<bp::copy_const_reference>()));
+
   bp::class_<RobotHandler>("RobotHandler", bp::init<>())
       .def("initialize", &initialize)
       .def("getSettings", &getSettings)
@@ -136,7 +167,18 @@ void exposeHandler() {
       .def("getMassMatrix",
            bp::make_function(
                &RobotHandler::getMassMatrix,
-               bp::return_value_policy<bp::copy_const_reference>()));
+               bp::return_value_policy<bp::copy_const_reference>()))
+      .def("getFrameKinematics", &RobotHandler::getFrameKinematics,
+           bp::return_internal_reference<>())
+      .def("trackFrame", &RobotHandler::trackFrame,
+           bp::args("self", "frame_name"))
+      .def("computeMass", &RobotHandler::computeMass, bp::args("self"))
+      .def("publishModel", &publishModel, bp::args("self"))
+      .def("setLinkInertia", &RobotHandler::setLinkInertia,
+           bp::args("self", "joint_name", "inertia"))
+      .def("setMass", &RobotHandler::setMass, bp::args("self", "mass"))
+      .def("mapState", &RobotHandler::mapState,
+           bp::args("self", "source", "x"));
 
   return;
 }
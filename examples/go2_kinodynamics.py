@@ -249,21 +249,14 @@ for t in range(5000):
 
         state_diff = mpc.getHandler().difference(x_measured, mpc.xs[0])
         mpc.getHandler().updateState(q_current, v_current, True)
+        # Full control layout, stages may drop the forces of their swing feet
+        u0 = mpc.getFullControl(0)
+        K0 = mpc.getFullFeedback()
 
-        a0[6:] = (
-            mpc.us[0][nk * force_size :]
-            - 1
-            * mpc.getSolver().results.controlFeedbacks()[0][nk * force_size :]
-            @ state_diff
-        )
-        forces = (
-            mpc.us[0][: nk * force_size]
-            - 1
-            * mpc.getSolver().results.controlFeedbacks()[0][: nk * force_size]
-            @ state_diff
-        )
-        # a0[6:] = mpc.us[0][nk * force_size :]
-        # forces = mpc.us[0][: nk * force_size]
+        a0[6:] = u0[nk * force_size :] - 1 * K0[nk * force_size :] @ state_diff
+        forces = u0[: nk * force_size] - 1 * K0[: nk * force_size] @ state_diff
+        # a0[6:] = u0[nk * force_size :]
+        # forces = u0[: nk * force_size]
 
         qp.solve_qp(
             mpc.getHandler().getData(),
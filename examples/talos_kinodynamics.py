@@ -268,18 +268,11 @@ for t in range(600):
 
         state_diff = mpc.getHandler().difference(x_measured, mpc.xs[0])
         mpc.getHandler().updateState(q_current, v_current, True)
-        a0[6:] = (
-            mpc.us[0][nk * force_size :]
-            - 1
-            * mpc.getSolver().results.controlFeedbacks()[0][nk * force_size :]
-            @ state_diff
-        )
-        forces = (
-            mpc.us[0][: nk * force_size]
-            - 1
-            * mpc.getSolver().results.controlFeedbacks()[0][: nk * force_size]
-            @ state_diff
-        )
+        # Full control layout, stages may drop the forces of their swing feet
+        u0 = mpc.getFullControl(0)
+        K0 = mpc.getFullFeedback()
+        a0[6:] = u0[nk * force_size :] - 1 * K0[nk * force_size :] @ state_diff
+        forces = u0[: nk * force_size] - 1 * K0[: nk * force_size] @ state_diff
         qp.solve_qp(
             mpc.getHandler().getData(),
             contact_states,
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "simple-mpc/fwd.hpp"
+#include "simple-mpc/joint-limit-residual.hpp"
 #include "simple-mpc/robot-handler.hpp"
 
 #include <aligator/core/cost-abstract.hpp>
@@ -134,6 +135,47 @@ public:
   void setReferenceControl(const std::size_t t, const Eigen::VectorXd &u_ref);
   const Eigen::VectorXd getReferenceControl(const std::size_t t);
 
+  // Update in place the weights of one quadratic cost component in every
+  // stage of the problem. All the stages are checked before any is modified.
+  void setCostWeights(const std::string &cost_name,
+                      const Eigen::MatrixXd &weights);
+  // Same update for a single stage, e.g. one stored outside the problem.
+  // Returns false if the stage has no component with this key.
+  virtual bool setStageCostWeights(StageModel &stage,
+                                   const CostStack::CostKey &key,
+                                   const Eigen::MatrixXd &weights);
+  // Checks of setStageCostWeights without modifying the stage: returns
+  // false if the stage has no component with this key, throws if the
+  // component cannot take the weights
+  virtual bool checkStageCostWeights(StageModel &stage,
+                                     const CostStack::CostKey &key,
+                                     const Eigen::MatrixXd &weights);
+
+  // Control of stage t in the layout of getNu(), with every foot, e.g. to
+  // hand it to the low-level controllers. Only differs from u when stages
+  // drop the force variables of their swing feet.
+  virtual Eigen::VectorXd getFullControl(const std::size_t /*t*/,
+                                         const Eigen::VectorXd &u) {
+    return u;
+  }
+
+  // Propagate a change of the inertias of the handler model, see
+  // RobotHandler::setLinkInertia, to the model copies and masses held by the
+  // residuals and dynamics of a stage, and scale its contact force
+  // references by force_scale. The stage is updated in place, its data are
+  // to be created again.
+  virtual void updateStageInertias(StageModel &stage,
+                                   const double force_scale);
+  // Same for every stage of the problem, the terminal cost and the terminal
+  // constraints
+  void updateInertias(const double force_scale);
+
+  // Stretch a stage in time: multiply its integration timestep and the
+  // scalar weight of each cost component by factor. Used to let one stage
+  // stand for several control periods at the end of the horizon, on copies
+  // of unscaled stages so that no scaling has to be undone.
+  void scaleStage(StageModel &stage, const double factor);
+
   // Getter for various objects and quantities
   CostStack *getCostStack(std::size_t t);
   CostStack *getTerminalCostStack();
@@ -155,6 +197,19 @@ protected:
   /// The robot model
   RobotHandler handler_;
 
+  // Names of the per-foot cost components, built once so that reference
+  // updates do not allocate a new string at every call
+  std::map<std::string, std::string> pose_cost_names_;
+  std::map<std::string, std::string> force_cost_names_;
+
+  // Model copies of the residuals of a cost stack, see updateStageInertias
+  virtual void updateCostInertias(CostStack & /*cs*/) {}
+  // Quadratic component of a stage cost with weights of the given size,
+  // nullptr if the stage has no component with this key
+  QuadraticResidualCost *getQuadraticCost(StageModel &stage,
+                                          const CostStack::CostKey &key,
+                                          const long rows, const long cols);
+
   /// The reference shooting problem storing all shooting nodes
   std::shared_ptr<TrajOptProblem> problem_;
 
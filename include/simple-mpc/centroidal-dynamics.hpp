@@ -109,12 +109,16 @@ public:
                        const Eigen::VectorXd &velocity_base) override;
   const Eigen::VectorXd getProblemState() override;
   size_t getContactSupport(const std::size_t t) override;
+  void updateStageInertias(StageModel &stage,
+                           const double force_scale) override;
 
   CentroidalSettings getSettings() { return settings_; }
 
 protected:
   CentroidalSettings settings_;
   int nx_;
+
+  void updateCostInertias(CostStack &cs) override;
 };
 
 } // namespace simple_mpc
@@ -45,6 +45,11 @@ protected:
   int T_contact_;
   size_t T_;
 
+  // Point of the swing Bezier curve of defineTranslationBezier at s in [0, 1],
+  // evaluated in closed form without building the curve
+  point3_t evaluateSwing(const double s, const point3_t &trans_init,
+                         const point3_t &trans_final) const;
+
 public:
   FootTrajectory() {};
   virtual ~FootTrajectory() {};
@@ -52,12 +57,15 @@ public:
                  double swing_apex, int T_fly, int T_contact, size_t T);
 
   void updateForward(double swing_apex);
+  void setHorizon(size_t T) { T_ = T; }
   piecewise_curve defineTranslationBezier(point3_t &trans_init,
                                           point3_t &trans_final);
   std::vector<point3_t> createTrajectory(int time_to_land,
                                          point3_t &initial_trans,
                                          point3_t &final_trans,
                                          piecewise_curve trajectory_swing);
+  // Overwrite the reference of ee_name in place, does not allocate once the
+  // reference has reached the horizon length
   void updateTrajectory(bool update, int landing_time, const point3_t &ee_trans,
                         const point3_t &final_trans,
                         const std::string &ee_name);
@@ -68,6 +68,10 @@ public:
   // Kinematics limits
   Eigen::VectorXd qmin;
   Eigen::VectorXd qmax;
+
+  // Omit the placement cost of stance feet, already held fixed by the rigid
+  // contact constraint. Pose references of stance feet are then ignored.
+  bool prune_stance_costs = false;
 };
 
 class FullDynamicsProblem : public Problem {
@@ -116,9 +120,16 @@ public:
                        const Eigen::VectorXd &velocity_base) override;
   const Eigen::VectorXd getProblemState() override;
   size_t getContactSupport(const std::size_t t) override;
+  void updateStageInertias(StageModel &stage,
+                           const double force_scale) override;
   FullDynamicsSettings getSettings() { return settings_; }
 
 protected:
+  void updateCostInertias(CostStack &cs) override;
+  // Pose cost of a foot at stage t, nullptr if it was pruned
+  QuadraticResidualCost *getPoseCost(const std::size_t t,
+                                     const std::string &ee_name);
+
   // Problem settings
   FullDynamicsSettings settings_;
   ProximalSettings prox_settings_;
@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 2-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <aligator/core/unary-function.hpp>
+#include <memory>
+#include <pinocchio/multibody/model.hpp>
+#include <vector>
+
+namespace simple_mpc {
+using UnaryFunction = aligator::UnaryFunctionTpl<double>;
+
+/**
+ * @brief Position of the actuated joints relative to the neutral
+ * configuration, i.e. rows 6 to nv of StateErrorResidual on the neutral state.
+ *
+ * Every actuated joint must have a single degree of freedom, so that the
+ * Jacobian is a constant selection. It is filled once in createData and the
+ * evaluation only reads the joint positions.
+ */
+class JointLimitResidual : public UnaryFunction {
+public:
+  using Data = aligator::StageFunctionDataTpl<double>;
+  using ConstVectorRef = Eigen::Ref<const Eigen::VectorXd>;
+
+  JointLimitResidual(const pinocchio::Model &model, const int nu);
+
+  void evaluate(const ConstVectorRef &x, Data &data) const override;
+  // The Jacobian is constant and set at data creation
+  void computeJacobians(const ConstVectorRef &, Data &) const override {}
+  std::shared_ptr<Data> createData() const override;
+
+protected:
+  // Configuration and tangent index of each actuated joint
+  std::vector<Eigen::Index> q_ids_;
+  std::vector<Eigen::Index> v_ids_;
+  Eigen::VectorXd q_neutral_;
+};
+
+} // namespace simple_mpc
@@ -49,6 +49,11 @@ struct KinodynamicsSettings {
   double Lfoot;
   double Wfoot;
   int force_size;
+
+  // Give each stage force variables for its active contacts only, instead
+  // of one per foot. Controls then change size with the contact pattern,
+  // see getFullControl.
+  bool active_forces_only = false;
 };
 
 class KinodynamicsProblem : public Problem {
@@ -103,11 +108,35 @@ public:
   void computeControlFromForces(
       const std::map<std::string, Eigen::VectorXd> &force_refs);
 
+  bool setStageCostWeights(StageModel &stage, const CostStack::CostKey &key,
+                           const Eigen::MatrixXd &weights) override;
+  bool checkStageCostWeights(StageModel &stage, const CostStack::CostKey &key,
+                             const Eigen::MatrixXd &weights) override;
+  Eigen::VectorXd getFullControl(const std::size_t t,
+                                 const Eigen::VectorXd &u) override;
+  void updateStageInertias(StageModel &stage,
+                           const double force_scale) override;
+
   KinodynamicsSettings getSettings() { return settings_; }
 
 protected:
   KinodynamicsSettings settings_;
   Eigen::VectorXd x0_;
+
+  void updateCostInertias(CostStack &cs) override;
+
+  // Indices in getFeetNames() of the feet with force variables in the stage,
+  // in the order of the control
+  std::vector<std::size_t> getForceFeet(StageModel &stage);
+  // Indices in the full control of the entries of a stage control
+  std::vector<Eigen::Index>
+  getControlIndices(const std::vector<std::size_t> &force_feet);
+  // Entries of a full control, or of full control weights, that belong to
+  // a stage control
+  Eigen::VectorXd reduceControl(const std::vector<std::size_t> &force_feet,
+                                const Eigen::VectorXd &u_full);
+  Eigen::MatrixXd reduceWeights(const std::vector<std::size_t> &force_feet,
+                                const Eigen::MatrixXd &w_full);
 };
 
 } // namespace simple_mpc
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMPLE_MPC_LOWLEVEL_BATCH_HPP_
+#define SIMPLE_MPC_LOWLEVEL_BATCH_HPP_
+
+#include "simple-mpc/lowlevel-control.hpp"
+
+namespace simple_mpc {
+/**
+ * @brief Solve the low-level QPs of many robot instances sharing the same
+ * model and contact set.
+ *
+ * Inputs and results are stored column-wise, one column per instance, and
+ * instances are split between OpenMP threads. Each instance keeps its own
+ * QP so that warm starts are not mixed between robots.
+ */
+
+class IDBatchSolver {
+
+protected:
+  std::vector<IDSolver> solvers_;
+  int num_threads_;
+
+  // Per-instance input buffers, so that columns are not copied into
+  // temporaries
+  std::vector<Eigen::VectorXd> v_;
+  std::vector<Eigen::VectorXd> a_;
+  std::vector<Eigen::VectorXd> forces_;
+
+public:
+  IDBatchSolver();
+  IDBatchSolver(const IDSettings &settings, const pinocchio::Model &model,
+                const std::size_t batch_size, const int num_threads);
+  void initialize(const IDSettings &settings, const pinocchio::Model &model,
+                  const std::size_t batch_size, const int num_threads);
+
+  // Solve every instance; column i of v, a and forces belongs to instance i
+  // and datas[i] must hold its kinematics, dynamics and mass matrix
+  void solve(std::vector<pinocchio::Data> &datas,
+             const std::vector<std::vector<bool>> &contact_states,
+             const Eigen::MatrixXd &v, const Eigen::MatrixXd &a,
+             const Eigen::MatrixXd &forces);
+
+  std::size_t getBatchSize() { return solvers_.size(); }
+  IDSolver &getSolver(const std::size_t i) { return solvers_.at(i); }
+
+  // QP results, one column per instance
+  Eigen::MatrixXd solved_forces_;
+  Eigen::MatrixXd solved_acc_;
+  Eigen::MatrixXd solved_torque_;
+};
+
+class IKIDBatchSolver {
+
+protected:
+  std::vector<IKIDSolver> solvers_;
+  int num_threads_;
+
+  // Per-instance input buffers
+  std::vector<Eigen::VectorXd> x_measured_;
+  std::vector<Eigen::VectorXd> v_;
+  std::vector<Eigen::VectorXd> forces_;
+  std::vector<Eigen::VectorXd> dH_;
+
+public:
+  IKIDBatchSolver();
+  IKIDBatchSolver(const IKIDSettings &settings, const pinocchio::Model &model,
+                  const std::size_t batch_size, const int num_threads);
+  void initialize(const IKIDSettings &settings, const pinocchio::Model &model,
+                  const std::size_t batch_size, const int num_threads);
+
+  // Same as IKIDSolver::computeDifferences followed by solve_qp for every
+  // instance; column i of x_measured, forces and dH belongs to instance i
+  void solve(std::vector<pinocchio::Data> &datas,
+             const std::vector<std::vector<bool>> &contact_states,
+             const Eigen::MatrixXd &x_measured, const Eigen::MatrixXd &forces,
+             const Eigen::MatrixXd &dH,
+             const std::vector<std::vector<pinocchio::SE3>> &foot_refs,
+             const std::vector<std::vector<pinocchio::SE3>> &foot_refs_next);
+
+  std::size_t getBatchSize() { return solvers_.size(); }
+  IKIDSolver &getSolver(const std::size_t i) { return solvers_.at(i); }
+
+  // QP results, one column per instance
+  Eigen::MatrixXd solved_forces_;
+  Eigen::MatrixXd solved_acc_;
+  Eigen::MatrixXd solved_torque_;
+};
+
+} // namespace simple_mpc
+
+/* --- Details -------------------------------------------------------------- */
+/* --- Details -------------------------------------------------------------- */
+/* --- Details -------------------------------------------------------------- */
+
+#endif // SIMPLE_MPC_LOWLEVEL_BATCH_HPP_
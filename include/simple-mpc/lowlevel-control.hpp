@@ -10,6 +10,7 @@
 #define SIMPLE_MPC_LOWLEVEL_CONTROL_HPP_
 
 #include "simple-mpc/fwd.hpp"
+#include "simple-mpc/robot-handler.hpp"
 #include <Eigen/Cholesky>
 #include <Eigen/Core>
 #include <pinocchio/multibody/fwd.hpp>
@@ -37,6 +38,7 @@ public:
   double w_force;  // Weight for force regularization
   double w_acc;    // Weight for acceleration regularization
   bool verbose;    // Print solver information
+  bool closed_form = true; // Try the solution without friction cones first
 };
 
 struct IKIDSettings {
@@ -65,7 +67,8 @@ class IDSolver {
 protected:
   IDSettings settings_;
   std::shared_ptr<proxqp::dense::QP<double>> qp_;
-  pinocchio::Model model_;
+  // Shared with the RobotHandler (or sibling solvers), never modified here
+  std::shared_ptr<const pinocchio::Model> model_;
   int force_dim_;
   int nforcein_;
   int nk_;
@@ -80,11 +83,32 @@ protected:
   Eigen::VectorXd l_;
   Eigen::VectorXd u_;
   Eigen::Matrix3d baum_gains_;
-  Motion Jvel_;
 
   Eigen::MatrixXd Jc_;
   Eigen::VectorXd gamma_;
-  Eigen::MatrixXd Jdot_;
+
+  // Contact kinematics, either filled here or shared by the caller
+  FrameKinematicsCache kinematics_;
+  std::shared_ptr<const FrameKinematicsCache> shared_kinematics_;
+  // Cache slots of contact_ids, looked up once
+  std::vector<std::size_t> contact_slots_;
+
+  // Closed-form solution once torques are eliminated: equality constraints
+  // E (da, df) = e, with an inactive contact constrained to df = 0
+  Eigen::MatrixXd E_;
+  Eigen::MatrixXd EW_;
+  Eigen::MatrixXd K_;
+  Eigen::LDLT<Eigen::MatrixXd> K_ldlt_;
+  Eigen::VectorXd e_;
+  Eigen::VectorXd lambda_;
+  Eigen::VectorXd y_;
+  Eigen::VectorXd w_inv_;
+  Eigen::VectorXd cone_;
+
+  // Statistics
+  std::size_t solve_count_ = 0;
+  std::size_t closed_form_count_ = 0;
+  double solve_time_ = 0;
 
   // Internal matrix computation
   void computeMatrice(pinocchio::Data &data,
@@ -92,10 +116,32 @@ protected:
                       const Eigen::VectorXd &v, const Eigen::VectorXd &a,
                       const Eigen::VectorXd &forces, const Eigen::MatrixXd &M);
 
+  // Solve without inequalities and check the friction cones; returns false
+  // if the QP is needed
+  bool solveClosedForm(const std::vector<bool> &contact_state,
+                       const Eigen::VectorXd &a, const Eigen::VectorXd &forces,
+                       const Eigen::MatrixXd &M);
+
 public:
   IDSolver();
   IDSolver(const IDSettings &settings, const pinocchio::Model &model);
+  IDSolver(const IDSettings &settings,
+           std::shared_ptr<const pinocchio::Model> model);
+  // Copies the model into a handle owned by this solver
   void initialize(const IDSettings &settings, const pinocchio::Model &model);
+  // Shares the model, e.g. RobotHandler::getModelHandle(), without a copy
+  void initialize(const IDSettings &settings,
+                  std::shared_ptr<const pinocchio::Model> model);
+  // Switch to another snapshot of the same model, e.g. the one published by
+  // RobotHandler::publishModel after an inertia change
+  void updateModel(std::shared_ptr<const pinocchio::Model> model);
+
+  // Read contact kinematics from a cache kept up to date by the caller, e.g.
+  // RobotHandler::getFrameKinematicsHandle(), instead of computing them from
+  // data. The solver shares its ownership, nullptr goes back to computing
+  // them.
+  void
+  useFrameKinematics(std::shared_ptr<const FrameKinematicsCache> cache);
 
   void solve_qp(pinocchio::Data &data, const std::vector<bool> &contact_state,
                 const Eigen::VectorXd &v, const Eigen::VectorXd &a,
@@ -107,6 +153,13 @@ public:
   Eigen::VectorXd getg() { return qp_->model.g; }
   Eigen::VectorXd getb() { return qp_->model.b; }
 
+  // Share of solves answered by the closed-form solution
+  double getClosedFormRate() {
+    return solve_count_ == 0 ? 0 : (double)closed_form_count_ / solve_count_;
+  }
+  // Duration of the last solve_qp call in microseconds
+  double getSolveTime() { return solve_time_; }
+
   // QP results
   Eigen::VectorXd solved_forces_;
   Eigen::VectorXd solved_acc_;
@@ -118,7 +171,8 @@ class IKIDSolver {
 protected:
   IKIDSettings settings_;
   std::shared_ptr<proxqp::dense::QP<double>> qp_;
-  pinocchio::Model model_;
+  // Shared with the RobotHandler (or sibling solvers), never modified here
+  std::shared_ptr<const pinocchio::Model> model_;
   int force_dim_;
   int nforcein_;
   int nk_;
@@ -135,12 +189,10 @@ protected:
   Eigen::VectorXd u_;
   Eigen::VectorXd l_box_;
   Eigen::VectorXd u_box_;
-  Motion Jvel_;
 
-  Eigen::MatrixXd Jfoot_;
-  Eigen::MatrixXd dJfoot_;
-  Eigen::MatrixXd Jframe_;
-  Eigen::MatrixXd dJframe_;
+  // Task Jacobians stacked by group, one rank update per group
+  Eigen::MatrixXd Jfeet_;
+  Eigen::MatrixXd Jframes_;
 
   std::vector<Eigen::VectorXd> foot_diffs_;
   std::vector<Eigen::VectorXd> dfoot_diffs_;
@@ -149,6 +201,14 @@ protected:
   Eigen::VectorXd q_diff_;
   Eigen::VectorXd dq_diff_;
 
+  // Contact and fixed frame kinematics, either filled in computeDifferences
+  // or shared by the caller
+  FrameKinematicsCache kinematics_;
+  std::shared_ptr<const FrameKinematicsCache> shared_kinematics_;
+  // Cache slots of contact_ids and fixed_frame_ids, looked up once
+  std::vector<std::size_t> contact_slots_;
+  std::vector<std::size_t> frame_slots_;
+
   // Internal matrix computation
   void computeMatrice(pinocchio::Data &data,
                       const std::vector<bool> &contact_state,
@@ -159,7 +219,23 @@ protected:
 public:
   IKIDSolver();
   IKIDSolver(const IKIDSettings &settings, const pinocchio::Model &model);
+  IKIDSolver(const IKIDSettings &settings,
+             std::shared_ptr<const pinocchio::Model> model);
+  // Copies the model into a handle owned by this solver
   void initialize(const IKIDSettings &settings, const pinocchio::Model &model);
+  // Shares the model, e.g. RobotHandler::getModelHandle(), without a copy
+  void initialize(const IKIDSettings &settings,
+                  std::shared_ptr<const pinocchio::Model> model);
+  // Switch to another snapshot of the same model, e.g. the one published by
+  // RobotHandler::publishModel after an inertia change
+  void updateModel(std::shared_ptr<const pinocchio::Model> model);
+
+  // Read frame kinematics from a cache kept up to date by the caller, e.g.
+  // RobotHandler::getFrameKinematicsHandle(), instead of computing them from
+  // data. The solver shares its ownership, nullptr goes back to computing
+  // them.
+  void
+  useFrameKinematics(std::shared_ptr<const FrameKinematicsCache> cache);
 
   void computeDifferences(pinocchio::Data &data,
                           const Eigen::VectorXd &x_measured,
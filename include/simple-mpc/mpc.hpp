@@ -16,11 +16,14 @@
 #include "aligator/modelling/multibody/centroidal-momentum-derivative.hpp"
 #include "aligator/modelling/multibody/centroidal-momentum.hpp"
 #include "aligator/solvers/proxddp/solver-proxddp.hpp"
+#include <deque>
 #include <pinocchio/algorithm/proximal.hpp>
 
 #include "simple-mpc/base-problem.hpp"
 #include "simple-mpc/foot-trajectory.hpp"
 #include "simple-mpc/fwd.hpp"
+#include "simple-mpc/ocp-solver.hpp"
+#include "simple-mpc/realtime.hpp"
 #include "simple-mpc/robot-handler.hpp"
 
 namespace simple_mpc {
@@ -56,20 +59,65 @@ public:
   // Force parameters
   double support_force = 1000;
 
-  // Solver-related quantities
+  // Solver-related quantities. FDDP ignores the constraints, SOLVER_AUTO
+  // picks it at each solve when the problem has none.
+  SolverBackend solver_backend = SOLVER_PROXDDP;
   double TOL = 1e-4;
   double mu_init = 1e-8;
   std::size_t max_iters = 1;
   std::size_t num_threads = 2;
   int ddpIteration = 1;
 
+  // Solution health checks: a solve is rejected when it is not finite, when
+  // its cost exceeds max_cost_ratio times the cost of the previous solve, or
+  // when its primal infeasibility exceeds max_prim_infeas
+  double max_cost_ratio = 1e3;
+  double max_prim_infeas = 1e-1;
+
   // Timings
   int T_fly = 80;
   int T_contact = 20;
   size_t T = 100;
   double dt = 0.01;
+
+  // Move blocking: stages from index blocking_start to the end of the
+  // horizon each stand for blocking_factor nodes of dt with one control, so
+  // that a horizon of blocking_start + (N - blocking_start) / blocking_factor
+  // stages covers N nodes. Disabled when the factor is 1.
+  size_t blocking_start = 0;
+  size_t blocking_factor = 1;
+
+  // Solve skipping: the solve is skipped and the shifted plan is kept when
+  // the measured state is within skip_state_tol (manifold distance) of its
+  // prediction and the base velocity command moved by less than
+  // skip_reference_tol since the last solve. At most max_skipped_solves
+  // ticks are skipped in a row. Disabled when skip_state_tol is 0.
+  double skip_state_tol = 0;
+  double skip_reference_tol = 1e-3;
+  size_t max_skipped_solves = 1;
+
+  // Command predictor: on the tick following a change of the base velocity
+  // command, the shifted plan is moved to first order before the solve. The
+  // velocity change is ramped from the first node to the tail, where the
+  // command is tracked, and integrated into the base placements. Controls
+  // follow through the feedback gains of the last solve. Only applies to
+  // problems whose state is [q; v].
+  bool predict_command = false;
+
+  // Print the duration of the recede and solve steps of each iteration
+  bool verbose = true;
 };
 class MPC {
+public:
+  using ContactSchedule =
+      Eigen::Matrix<bool, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  enum SolutionStatus {
+    SOLUTION_OK,
+    SOLUTION_NOT_FINITE,
+    SOLUTION_COST_JUMP,
+    SOLUTION_INFEASIBLE
+  };
 
 protected:
   enum LocomotionType { WALKING, STANDING, MOTION };
@@ -83,11 +131,95 @@ protected:
   std::vector<std::shared_ptr<StageData>> one_horizon_data_;
   std::vector<std::shared_ptr<StageModel>> standing_horizon_;
   std::vector<std::shared_ptr<StageData>> standing_horizon_data_;
-  std::shared_ptr<SolverProxDDP> solver_;
+  std::shared_ptr<OCPSolver> solver_;
+  // Stage template of each contact and landing pattern, built once and
+  // copied into the problem when a node of that pattern enters the horizon
+  using StagePattern =
+      std::pair<std::map<std::string, bool>, std::map<std::string, bool>>;
+  struct StageTemplate {
+    std::shared_ptr<StageModel> model;
+    // Data handed to the solver by the nodes of this pattern, in turn. One
+    // is only handed again once nothing else holds it.
+    std::vector<std::shared_ptr<StageData>> data;
+    std::size_t next_data = 0;
+    // Copy scaled for the blocked region of move blocking, with its own
+    // data, built on first use
+    std::shared_ptr<StageTemplate> blocked;
+  };
+  std::map<StagePattern, StageTemplate> stage_pool_;
+  StageTemplate &getStageTemplate(const std::map<std::string, bool> &contacts,
+                                  const std::map<std::string, bool> &lands);
+  StageTemplate &getBlockedTemplate(const StagePattern &pattern);
+  // Drop the data of the templates, they are created again when handed
+  static void clearTemplateData(std::map<StagePattern, StageTemplate> &pool);
+  // Queued nodes of a non-periodic contact plan, with their stage and data
+  // resolved when they were appended
+  struct PlanNode {
+    std::map<std::string, bool> contacts;
+    std::shared_ptr<StageModel> stage;
+    std::shared_ptr<StageData> data;
+  };
+  std::deque<PlanNode> contact_plan_;
+  // Contacts of the last stage of the horizon
+  std::map<std::string, bool> tail_contacts_;
+  // Contacts of each node of the horizon
+  std::vector<std::map<std::string, bool>> horizon_contacts_;
+  // Reduced-model variants registered with addModelVariant. The members
+  // bound to the problem of the active variant are swapped with the stored
+  // ones on a switch.
+  struct ModelVariant {
+    std::shared_ptr<Problem> problem;
+    std::shared_ptr<OCPSolver> solver;
+    std::vector<std::shared_ptr<StageModel>> standing_horizon;
+    std::vector<std::shared_ptr<StageData>> standing_horizon_data;
+    std::map<StagePattern, StageTemplate> stage_pool;
+    // Total mass the force references were computed for
+    double mass;
+  };
+  std::map<std::string, ModelVariant> model_variants_;
+  std::string active_variant_ = "default";
+  std::shared_ptr<OCPSolver> createSolver();
+  // Stages of the cycle horizon from the templates of the active problem,
+  // for the ring rotated by cycle_offset_
+  void buildCycleHorizon();
+  // Whether the next stage entering the horizon comes from the cycle
+  bool cycleNext();
+  // Append the events of the cycle ring as if it followed the horizon tail,
+  // when the plan runs out
+  void addResumeEvents();
+  // Remove the events beyond the horizon
+  void dropFutureEvents();
   FootTrajectory foot_trajectories_;
   std::map<std::string, pinocchio::SE3> relative_feet_poses_;
   // INTERNAL UPDATING function
   void updateStepTrackerReferences();
+  // Move blocking. The gait, its events and the foot references advance one
+  // node per recede as without blocking, stage t of the problem being the
+  // node getStageNode(t). Stages of the blocked region whose pattern no
+  // longer matches their node are copied again from the scaled templates
+  // and handed their data in place. The solver is only set up again when
+  // such a stage changes dimensions.
+  StagePattern getStagePattern(const std::size_t t);
+  void recedeBlockedStages();
+  // Copy the stages of the horizon from the templates of their pattern
+  void rebuildStages();
+  // Move the warm start by the given number of nodes, controls being held
+  // over the nodes of their stage
+  void shiftBlockedWarmStart(const std::size_t nodes);
+  // Stage covering the given node
+  std::size_t getNodeStage(const std::size_t node);
+  // Pattern of each stage of the horizon, kept with move blocking
+  std::vector<StagePattern> stage_patterns_;
+  Eigen::VectorXd blocking_x_;
+  // Next data of a template handed to the solver with a stage
+  std::shared_ptr<StageData> nextTemplateData(StageTemplate &stage);
+  // Copy the solver results into the candidate buffers while checking them,
+  // and swap them with the current plan if they are sound
+  SolutionStatus acceptSolution();
+  // Feedback gain of stage t of the last solve, copied into K
+  void getFeedback(const std::size_t t, Eigen::MatrixXd &K);
+  // Store the allocations of the tick counted by guard
+  void countTickAllocations(const AllocationGuard &guard);
 
   // Memory preallocations:
   std::vector<unsigned long> controlled_joints_id_;
@@ -95,8 +227,57 @@ protected:
   Eigen::VectorXd x_internal_;
   bool time_to_solve_ddp_ = false;
   Eigen::Vector3d com0_;
+  // Total mass the force references were computed for
+  double mass_;
   LocomotionType now_;
   Eigen::VectorXd velocity_base_;
+  // Horizon length the MPC was initialized with, upper bound for
+  // setHorizonLength
+  std::size_t max_horizon_;
+  // Candidate plan, swapped with xs_, us_, K0_ and K1_ when accepted
+  std::vector<Eigen::VectorXd> xs_candidate_;
+  std::vector<Eigen::VectorXd> us_candidate_;
+  Eigen::MatrixXd K0_candidate_;
+  // Feedback of the second stage, which becomes K0_ when the next tick is
+  // skipped or rejected. Only valid on the tick after an accepted solve.
+  Eigen::MatrixXd K1_;
+  Eigen::MatrixXd K1_candidate_;
+  bool K1_valid_ = false;
+  double last_cost_;
+  SolutionStatus solution_status_ = SOLUTION_OK;
+  std::size_t rejected_solutions_ = 0;
+  // Set by prepareRealTime
+  bool realtime_ = false;
+  std::size_t hot_path_allocations_ = 0;
+  std::size_t tick_allocations_ = 0;
+  std::size_t tick_recede_allocations_ = 0;
+  // Solve skipping bookkeeping
+  Eigen::VectorXd state_deviation_;
+  Eigen::VectorXd solved_velocity_base_;
+  bool solve_skipped_ = false;
+  std::size_t consecutive_skips_ = 0;
+  std::size_t skipped_solves_ = 0;
+  std::size_t iterations_ = 0;
+  double last_solve_time_ = 0;
+  double saved_solve_time_ = 0;
+  // Whether the solve of this tick can be skipped, to be called before the
+  // warm start is shifted
+  bool canSkipSolve();
+  Eigen::VectorXd predictor_dx_;
+  Eigen::VectorXd predictor_q_;
+  // Number of left rotations of the cycle ring since it was generated
+  std::size_t cycle_offset_ = 0;
+  // Append the events of contact_states_ as if the ring had just been
+  // generated
+  void addCycleEvents();
+  // Time of the last timed iterate and fraction of node elapsed since the
+  // last receded node boundary
+  bool clock_started_ = false;
+  double clock_time_ = 0;
+  double node_phase_ = 0;
+  // Body of iterate, receding the given number of nodes
+  void iterateNodes(const Eigen::VectorXd &q_current,
+                    const Eigen::VectorXd &v_current, const std::size_t nodes);
 
 public:
   MPC();
@@ -105,16 +286,86 @@ public:
                   std::shared_ptr<Problem> problem);
 
   // Generate the cycle walking problem along which we will iterate
-  // the receding horizon
+  // the receding horizon. Calling it again replaces the cycle, e.g. to switch
+  // gait, while the stages already in the horizon are kept.
   void generateCycleHorizon(
       const std::vector<std::map<std::string, bool>> &contact_states);
+  // Same, with one row per node and one column per foot in the order of
+  // RobotHandler::getFeetNames(). Binds to a C-contiguous boolean numpy
+  // array without copy.
+  void generateCycleHorizon(const Eigen::Ref<const ContactSchedule> &schedule);
 
-  // Perform one iteration of MPC
+  // Queue a non-periodic contact plan, one contact state per node. Queued
+  // nodes enter the horizon before the cycle, one per recede, and the cycle
+  // (or standing) resumes once they are used up. Stage templates and data
+  // are built here, so that receding only copies a template into the
+  // problem.
+  void appendContactPlan(
+      const std::vector<std::map<std::string, bool>> &contact_states);
+  void appendContactPlan(const Eigen::Ref<const ContactSchedule> &schedule);
+  // Queue footsteps: the given feet swing for swing_nodes while the others
+  // stand, then every foot stands for support_nodes
+  void appendFootsteps(const std::vector<std::string> &ee_names,
+                       const std::size_t swing_nodes,
+                       const std::size_t support_nodes);
+  // Drop the nodes not yet in the horizon
+  void clearContactPlan();
+  std::size_t getContactPlanSize() { return contact_plan_.size(); }
+
+  // Register a variant of the problem built on another reduced model of the
+  // robot, e.g. with the arms locked, with the same feet and horizon length.
+  // Its standing stages are built here and its stage templates on demand.
+  // The problem the MPC was initialized with is the variant "default".
+  void addModelVariant(const std::string &name,
+                       std::shared_ptr<Problem> problem);
+  // Make a registered variant the solved one, e.g. at a gait boundary. The
+  // horizon is rebuilt with the same contacts from the templates of the
+  // variant and the warm start is mapped joint by joint, locked joints
+  // taking their reference configuration. Both problems need a [q; v]
+  // state. Cost weight updates only apply to the active variant. Inertia
+  // updates apply to every variant, and a variant whose mass differs from
+  // the one of the active variant cannot be switched to.
+  void switchModelVariant(const std::string &name);
+  const std::string &getModelVariant() { return active_variant_; }
+
+  // Bring the MPC back to its state after initialize and generateCycleHorizon
+  // with the robot at the given state, e.g. to start a new simulation
+  // episode. Stage models are reused, with the cost weights set since then.
+  void reset(const Eigen::VectorXd &q_current,
+             const Eigen::VectorXd &v_current);
+
+  // Perform one iteration of MPC. The state is the one of the complete
+  // model or of the reduced model of the active variant.
   void iterate(const Eigen::VectorXd &q_current,
                const Eigen::VectorXd &v_current);
+  // Same, receding by the time elapsed since the previous call rather than by
+  // one node, so that the MPC can run at any rate. Whole nodes are receded
+  // when node boundaries are crossed and the foot references are shifted by
+  // the remaining fraction of node. The first call only starts the clock.
+  void iterate(const Eigen::VectorXd &q_current,
+               const Eigen::VectorXd &v_current, const double t_now);
+
+  // Perform the first iteration as a warm-up so that every buffer reaches
+  // its final size, then lock the process memory. The next iterations do not
+  // print timings and report their allocations when the library is built
+  // with ENABLE_ALLOCATION_GUARD, their count adding up in
+  // getHotPathAllocations. Throws if the memory cannot be locked.
+  void prepareRealTime(const Eigen::VectorXd &q_current,
+                       const Eigen::VectorXd &v_current);
 
   void updateCycleTiming(const bool updateOnlyHorizon);
 
+  // Node at which stage t of the horizon starts, in number of dt.
+  // getStageNode(T) is the number of nodes covered by T stages.
+  std::size_t getStageNode(const std::size_t t);
+  std::size_t getHorizonNodes() { return getStageNode(problem_->getSize()); }
+
+  // Change the number of stages of the running problem. Tail stages are
+  // given back to or taken from the cycle horizon so that the gait timing is
+  // preserved. The length is bounded by the one used at initialization, and
+  // cannot change while a contact plan is queued.
+  void setHorizonLength(const std::size_t T);
+
   // Recede the horizon
   void recedeWithCycle();
 
@@ -128,17 +379,69 @@ public:
   const pinocchio::SE3 getReferencePose(const std::size_t t,
                                         const std::string &ee_name);
 
+  // Update the weights of a cost component in the live problem, the cycle
+  // horizon and the standing horizon, without rebuilding any stage
+  void setCostWeights(const std::string &cost_name,
+                      const Eigen::MatrixXd &weights);
+
+  // Change the inertia of a link of the robot model, or its total mass,
+  // e.g. when a payload is picked up, and propagate it with updateInertias.
+  // The model variants having the link as a joint get the same inertia.
+  void setLinkInertia(const std::string &joint_name,
+                      const pinocchio::Inertia &inertia);
+  void setMass(const double mass);
+  // Propagate a change of the inertias of the handler model to the stages of
+  // the running problem, the standing horizon and the stage templates of the
+  // cycle and contact plans, in place. support_force and the contact force
+  // references are scaled with the total mass. The stages of the model
+  // variants are updated from the models of their own handlers. Stage data
+  // are created again and the solver is set up on them, the warm start
+  // being kept.
+  void updateInertias();
+
   void setVelocityBase(const Eigen::VectorXd &velocity_base) {
     velocity_base_ = velocity_base;
   };
+  // Move the warm start toward the change of velocity_base from the command
+  // of the last solve, ramped over the horizon, as iterate does when
+  // predict_command is set. The warm start has been shifted by the given
+  // number of nodes since that solve. Nothing is done when that solve was
+  // rejected.
+  void predictCommandChange(const std::size_t shift);
 
   // getters and setters
   MPCSettings &getSettings() { return settings_; }
 
   std::shared_ptr<Problem> getProblem() { return problem_; }
   TrajOptProblem &getTrajOptProblem() { return *problem_->getProblem(); }
-  SolverProxDDP &getSolver() { return *solver_; }
+  // ProxDDP solver of the backend, throws for SOLVER_FDDP
+  SolverProxDDP &getSolver();
+  OCPSolver &getOCPSolver() { return *solver_; }
+  // Backend of the last solve
+  SolverBackend getSolverBackend() { return solver_->getBackend(); }
   RobotHandler &getHandler() { return problem_->getHandler(); }
+  SolutionStatus getSolutionStatus() { return solution_status_; }
+  // Control of stage t and feedback gain of the first stage in the layout of
+  // Problem::getNu(), with the force variables of every foot, zero for the
+  // feet a stage leaves out
+  Eigen::VectorXd getFullControl(const std::size_t t);
+  Eigen::MatrixXd getFullFeedback();
+  std::size_t getRejectedSolutions() { return rejected_solutions_; }
+  std::size_t getHotPathAllocations() { return hot_path_allocations_; }
+  // Heap allocations of the last iterate, counted by an AllocationGuard in
+  // every build, and the part of them made while shaping the state and
+  // receding the horizon
+  std::size_t getTickAllocations() { return tick_allocations_; }
+  std::size_t getTickRecedeAllocations() { return tick_recede_allocations_; }
+  bool isSolveSkipped() { return solve_skipped_; }
+  std::size_t getSkippedSolves() { return skipped_solves_; }
+  double getSkipRate() {
+    return iterations_ == 0 ? 0. : (double)skipped_solves_ / iterations_;
+  }
+  // Sum of the duration of the last solve before each skipped tick [s]
+  double getSavedSolveTime() { return saved_solve_time_; }
+  // Fraction of node the references are ahead of the stage times
+  double getNodePhase() { return node_phase_; }
   std::vector<std::shared_ptr<StageModel>> &getCycleHorizon() {
     return cycle_horizon_;
   }
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 2-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <aligator/core/traj-opt-problem.hpp>
+#include <aligator/solvers/fddp/solver-fddp.hpp>
+#include <aligator/solvers/proxddp/solver-proxddp.hpp>
+#include <memory>
+#include <vector>
+
+namespace simple_mpc {
+using SolverProxDDP = aligator::SolverProxDDPTpl<double>;
+using SolverFDDP = aligator::SolverFDDPTpl<double>;
+using ResultsBase = aligator::ResultsBaseTpl<double>;
+using TrajOptProblem = aligator::TrajOptProblemTpl<double>;
+using StageData = aligator::StageDataTpl<double>;
+
+// FDDP ignores the stage and terminal constraints, SOLVER_AUTO only runs it
+// when the problem has none
+enum SolverBackend { SOLVER_PROXDDP, SOLVER_FDDP, SOLVER_AUTO };
+
+/**
+ * @brief Solver operations of the MPC loop: setup, warm-started run, stage
+ * cycling and results.
+ *
+ * The backend is picked once when the MPC is built, the loop then costs one
+ * virtual call per operation. Results are read through the results base
+ * class shared by the aligator solvers.
+ */
+class OCPSolver {
+public:
+  virtual ~OCPSolver() {}
+
+  virtual void setup(const TrajOptProblem &problem) = 0;
+  virtual void run(const TrajOptProblem &problem,
+                   const std::vector<Eigen::VectorXd> &xs,
+                   const std::vector<Eigen::VectorXd> &us) = 0;
+  // Hand the data of the stage appended by replaceStageCircular
+  virtual void cycleProblem(const TrajOptProblem &problem,
+                            const std::shared_ptr<StageData> &data) = 0;
+  // Hand the data of stage t after it was replaced by a stage of the same
+  // dimensions, and the data of its line-search trials. Returns false when
+  // the backend cannot take them in place and needs a setup.
+  virtual bool setStageData(const std::size_t /*t*/,
+                            const std::shared_ptr<StageData> & /*data*/,
+                            const std::shared_ptr<StageData> & /*trial*/) {
+    return false;
+  }
+  virtual void setMaxIters(const std::size_t max_iters) = 0;
+  // Zero the multipliers the next run warm-starts from, after a run whose
+  // solution was rejected
+  virtual void resetMultipliers() {}
+
+  // Results of the last run
+  virtual const ResultsBase &getResults() = 0;
+  // Backend of the last run, the one picked by SOLVER_AUTO
+  virtual SolverBackend getBackend() = 0;
+
+  // Underlying solvers, nullptr when not part of the backend
+  virtual SolverProxDDP *getProxDDP() { return nullptr; }
+  virtual SolverFDDP *getFDDP() { return nullptr; }
+};
+
+class ProxDDPSolver : public OCPSolver {
+public:
+  ProxDDPSolver(const double tol, const double mu_init,
+                const std::size_t max_iters, const std::size_t num_threads);
+
+  void setup(const TrajOptProblem &problem) override {
+    solver_.setup(problem);
+  }
+  void run(const TrajOptProblem &problem,
+           const std::vector<Eigen::VectorXd> &xs,
+           const std::vector<Eigen::VectorXd> &us) override {
+    solver_.run(problem, xs, us);
+  }
+  void cycleProblem(const TrajOptProblem &problem,
+                    const std::shared_ptr<StageData> &data) override {
+    solver_.cycleProblem(problem, data);
+  }
+  bool setStageData(const std::size_t t, const std::shared_ptr<StageData> &data,
+                    const std::shared_ptr<StageData> &trial) override {
+    solver_.workspace_.problem_data.stage_data[t] = data;
+    solver_.workspace_.trial_prob_data.stage_data[t] = trial;
+    return true;
+  }
+  void setMaxIters(const std::size_t max_iters) override {
+    solver_.max_iters = max_iters;
+  }
+  void resetMultipliers() override {
+    for (auto &lam : solver_.results_.lams)
+      lam.setZero();
+    for (auto &v : solver_.results_.vs)
+      v.setZero();
+  }
+  const ResultsBase &getResults() override { return solver_.results_; }
+  SolverBackend getBackend() override { return SOLVER_PROXDDP; }
+  SolverProxDDP *getProxDDP() override { return &solver_; }
+
+protected:
+  SolverProxDDP solver_;
+};
+
+class FDDPSolver : public OCPSolver {
+public:
+  FDDPSolver(const double tol, const std::size_t max_iters);
+
+  void setup(const TrajOptProblem &problem) override {
+    solver_.setup(problem);
+  }
+  void run(const TrajOptProblem &problem,
+           const std::vector<Eigen::VectorXd> &xs,
+           const std::vector<Eigen::VectorXd> &us) override {
+    solver_.run(problem, xs, us);
+  }
+  void cycleProblem(const TrajOptProblem &problem,
+                    const std::shared_ptr<StageData> &data) override {
+    solver_.cycleProblem(problem, data);
+  }
+  void setMaxIters(const std::size_t max_iters) override {
+    solver_.max_iters = max_iters;
+  }
+  const ResultsBase &getResults() override { return solver_.results_; }
+  SolverBackend getBackend() override { return SOLVER_FDDP; }
+  SolverFDDP *getFDDP() override { return &solver_; }
+
+protected:
+  SolverFDDP solver_;
+};
+
+// Runs FDDP on the problems without stage or terminal constraints and
+// ProxDDP otherwise. Both are kept set up and cycled, on the same stage
+// data since only one of them runs at a time.
+class AutoSolver : public OCPSolver {
+public:
+  AutoSolver(const double tol, const double mu_init,
+             const std::size_t max_iters, const std::size_t num_threads);
+
+  void setup(const TrajOptProblem &problem) override;
+  void run(const TrajOptProblem &problem,
+           const std::vector<Eigen::VectorXd> &xs,
+           const std::vector<Eigen::VectorXd> &us) override;
+  void cycleProblem(const TrajOptProblem &problem,
+                    const std::shared_ptr<StageData> &data) override;
+  void setMaxIters(const std::size_t max_iters) override;
+  void resetMultipliers() override { proxddp_.resetMultipliers(); }
+  const ResultsBase &getResults() override { return last_->getResults(); }
+  SolverBackend getBackend() override { return last_->getBackend(); }
+  SolverProxDDP *getProxDDP() override { return proxddp_.getProxDDP(); }
+  SolverFDDP *getFDDP() override { return fddp_.getFDDP(); }
+
+  // Whether a stage or the terminal node has constraints
+  static bool hasConstraints(const TrajOptProblem &problem);
+
+protected:
+  ProxDDPSolver proxddp_;
+  FDDPSolver fddp_;
+  OCPSolver *last_;
+};
+
+std::shared_ptr<OCPSolver> createOCPSolver(const SolverBackend backend,
+                                           const double tol,
+                                           const double mu_init,
+                                           const std::size_t max_iters,
+                                           const std::size_t num_threads);
+
+} // namespace simple_mpc
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMPLE_MPC_REALTIME_HPP_
+#define SIMPLE_MPC_REALTIME_HPP_
+
+#include <cstddef>
+
+namespace simple_mpc {
+/**
+ * @brief Helpers for running the control loop without page faults or heap
+ * allocations, e.g. under PREEMPT_RT
+ */
+
+// Lock the current and future pages of the process in RAM and touch
+// stack_size bytes of stack so that they are mapped before the control loop
+// starts. Throws if the memory cannot be locked (see RLIMIT_MEMLOCK).
+void lockMemory(const std::size_t stack_size = 512 * 1024);
+
+// Counts the heap allocations made by the current thread while it is alive,
+// in every build. The library hooks malloc and the aligned allocation
+// functions, which the global operator new and Eigen go through, so that
+// the count covers the whole process as long as the library is linked
+// rather than loaded with dlopen (see isEnabled).
+// With report set and the library built with ENABLE_ALLOCATION_GUARD, each
+// allocation is also reported on stderr with a stack trace, and debug builds
+// abort on the first one. The option also defines EIGEN_RUNTIME_NO_MALLOC
+// for the library and its users, so that Eigen asserts on its own
+// allocations under such a guard.
+class AllocationGuard {
+public:
+  explicit AllocationGuard(const bool report = true);
+  ~AllocationGuard();
+  AllocationGuard(const AllocationGuard &) = delete;
+  AllocationGuard &operator=(const AllocationGuard &) = delete;
+
+  // Allocations seen since construction
+  std::size_t getAllocations() const;
+
+  // Whether the allocations of this process go through the hook of the
+  // library, i.e. whether the guards count them
+  static bool isEnabled();
+
+protected:
+  std::size_t start_count_;
+  bool was_active_;
+  bool was_reporting_;
+};
+
+} // namespace simple_mpc
+
+#endif // SIMPLE_MPC_REALTIME_HPP_
@@ -13,6 +13,7 @@
 #include <pinocchio/algorithm/crba.hpp>
 #include <pinocchio/algorithm/model.hpp>
 #include <pinocchio/algorithm/rnea.hpp>
+#include <memory>
 #include <pinocchio/spatial/se3.hpp>
 #include <string>
 #include <vector>
@@ -50,8 +51,79 @@ public:
   bool load_rotor = false;
 };
 
+/**
+ * @brief Per-tick kinematics of a few frames.
+ *
+ * Velocities, Jacobians and Jacobian time variations are filled once from a
+ * Data whose joint Jacobians and their time variation are up to date, then
+ * read by every consumer of the tick.
+ */
+class FrameKinematicsCache {
+public:
+  FrameKinematicsCache() {}
+  FrameKinematicsCache(const Model &model,
+                       const std::vector<FrameIndex> &frame_ids,
+                       const bool local = true,
+                       const bool world_aligned = true);
+  void initialize(const Model &model, const std::vector<FrameIndex> &frame_ids,
+                  const bool local = true, const bool world_aligned = true);
+  void addFrame(const Model &model, const FrameIndex frame_id);
+
+  // Requires computeJointJacobiansTimeVariation on data for the current state
+  void update(const Model &model, Data &data);
+
+  // Position of a frame in the cache
+  std::size_t getSlot(const FrameIndex frame_id) const;
+  const std::vector<FrameIndex> &getFrameIds() const { return frame_ids_; }
+
+  // Quantities in the LOCAL frame
+  const Motion &getVelocity(const std::size_t slot) const {
+    return v_local_[slot];
+  }
+  const Data::Matrix6x &getJacobian(const std::size_t slot) const {
+    return J_local_[slot];
+  }
+  const Data::Matrix6x &getJacobianTimeVariation(const std::size_t slot) const {
+    return dJ_local_[slot];
+  }
+
+  // Quantities in the LOCAL_WORLD_ALIGNED frame
+  const Motion &getVelocityWorldAligned(const std::size_t slot) const {
+    return v_aligned_[slot];
+  }
+  const Data::Matrix6x &getJacobianWorldAligned(const std::size_t slot) const {
+    return J_aligned_[slot];
+  }
+  const Data::Matrix6x &
+  getJacobianTimeVariationWorldAligned(const std::size_t slot) const {
+    return dJ_aligned_[slot];
+  }
+
+protected:
+  bool local_ = true;
+  bool world_aligned_ = true;
+  std::vector<FrameIndex> frame_ids_;
+  std::vector<Motion> v_local_, v_aligned_;
+  std::vector<Data::Matrix6x> J_local_, J_aligned_;
+  std::vector<Data::Matrix6x> dJ_local_, dJ_aligned_;
+};
+
 class RobotHandler {
 private:
+  // Owner of the kinematics cache. Solvers reading it share the ownership, a
+  // copy of the handler fills a cache of its own.
+  struct FrameKinematicsOwner {
+    std::shared_ptr<FrameKinematicsCache> cache =
+        std::make_shared<FrameKinematicsCache>();
+    FrameKinematicsOwner() {}
+    FrameKinematicsOwner(const FrameKinematicsOwner &other)
+        : cache(std::make_shared<FrameKinematicsCache>(*other.cache)) {}
+    FrameKinematicsOwner &operator=(const FrameKinematicsOwner &other) {
+      *cache = *other.cache;
+      return *this;
+    }
+  };
+
   RobotHandlerSettings settings_;
 
   // Useful index
@@ -61,8 +133,11 @@ private:
 
   unsigned long root_ids_;
 
-  // Pinocchio objects
-  Model rmodel_complete_, rmodel_;
+  // Pinocchio objects. Solvers built on the handler share a read-only
+  // snapshot of the reduced model rather than copying it, see publishModel.
+  Model rmodel_complete_;
+  Model rmodel_;
+  std::shared_ptr<const Model> model_snapshot_;
   Data rdata_;
 
   // State vectors
@@ -76,6 +151,9 @@ private:
   double mass_ = 0;
   Eigen::Vector3d com_position_;
 
+  // Kinematics of feet, root and tracked frames, filled with the Jacobians
+  FrameKinematicsOwner frame_kinematics_;
+
 public:
   RobotHandler();
   RobotHandler(const RobotHandlerSettings &settings);
@@ -109,6 +187,8 @@ public:
   const Eigen::VectorXd &getCentroidalState() { return x_centroidal_; }
   const double &getMass() { return mass_; }
   const Model &getModel() { return rmodel_; }
+  // Last published snapshot of the reduced model
+  std::shared_ptr<const Model> getModelHandle() { return model_snapshot_; }
   const Model &getCompleteModel() { return rmodel_complete_; }
   const Data &getData() { return rdata_; }
   const Eigen::VectorXd &getConfiguration() { return q_; }
@@ -128,8 +208,38 @@ public:
   }
   const Eigen::Vector3d &getComPosition() { return com_position_; }
   const Eigen::MatrixXd &getMassMatrix() { return rdata_.M; }
+  const FrameKinematicsCache &getFrameKinematics() {
+    return *frame_kinematics_.cache;
+  }
+  // The same cache, for the solvers reading it, see useFrameKinematics
+  std::shared_ptr<const FrameKinematicsCache> getFrameKinematicsHandle() {
+    return frame_kinematics_.cache;
+  }
+  // Add a frame to the kinematics cache, filled from the next update with
+  // Jacobians
+  void trackFrame(const std::string &frame_name);
   // Compute the total robot mass
   void computeMass();
+  // Copy the reduced model into a new snapshot, returned by getModelHandle
+  // from now on. Solvers holding the previous one keep it until they are
+  // handed the new one, e.g. after setLinkInertia or setMass.
+  std::shared_ptr<const Model> publishModel();
+  // Change the inertia of the link carried by a joint of the reduced model,
+  // e.g. when the robot picks up a payload, and update the total mass. Only
+  // this handler sees it, the snapshot being left to publishModel.
+  void setLinkInertia(const std::string &joint_name, const Inertia &inertia);
+  // Scale every link inertia so that the total mass becomes mass, the
+  // centers of mass being unchanged
+  void setMass(const double mass);
+  // Map a state [q; v] of another reduced model of the same robot, e.g.
+  // one controlling fewer joints, to this reduced model. Joints locked in
+  // the source model take their reference configuration and zero velocity.
+  Eigen::VectorXd mapState(const Model &source, const Eigen::VectorXd &x);
+  // Map a vector over the actuated joints of the source model (velocity
+  // indices 6 to nv), e.g. torques, to the actuated joints of this model.
+  // Entries of the joints locked in the source are left unchanged.
+  void mapActuated(const Model &source, const Eigen::VectorXd &u_source,
+                   Eigen::Ref<Eigen::VectorXd> u);
 };
 
 } // namespace simple_mpc
@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMPLE_MPC_WEIGHT_TUNING_HPP_
+#define SIMPLE_MPC_WEIGHT_TUNING_HPP_
+
+#include <functional>
+#include <random>
+
+#include "simple-mpc/mpc.hpp"
+
+namespace simple_mpc {
+/**
+ * @brief Closed-loop tuning of the cost weights of an MPC.
+ *
+ * Each candidate scales the diagonals of the tuned cost components by
+ * exp(theta), runs one closed-loop episode and is scored by a user objective.
+ * Candidates are drawn by CMA-ES and evaluated in parallel with OpenMP, one
+ * MPC per thread. The MPCs are built once and reset between episodes, the
+ * weights being updated in place with MPC::setCostWeights.
+ */
+
+// Ask-and-tell CMA-ES minimizer, with the default strategy parameters of
+// Hansen's tutorial (rank-one and rank-mu updates, cumulative step size)
+class CMAES {
+protected:
+  std::size_t n_;
+  std::size_t lambda_;
+  std::size_t mu_;
+  Eigen::VectorXd weights_;
+  double mu_eff_;
+  double c_sigma_;
+  double d_sigma_;
+  double c_c_;
+  double c_1_;
+  double c_mu_;
+  double chi_n_;
+
+  Eigen::VectorXd mean_;
+  double sigma_;
+  Eigen::MatrixXd C_;
+  Eigen::MatrixXd B_;
+  Eigen::VectorXd D_;
+  Eigen::VectorXd p_sigma_;
+  Eigen::VectorXd p_c_;
+  std::size_t generation_ = 0;
+
+  std::mt19937 generator_;
+  std::normal_distribution<double> normal_;
+  // Standard normal draws of the current population
+  std::vector<Eigen::VectorXd> z_;
+  std::vector<Eigen::VectorXd> samples_;
+
+public:
+  // A population size of 0 picks 4 + 3 ln(n)
+  CMAES(const Eigen::VectorXd &mean, const double sigma,
+        const std::size_t population_size, const unsigned int seed);
+
+  // Draw a new population
+  const std::vector<Eigen::VectorXd> &ask();
+  // Update the distribution with the cost of each sample of the last ask
+  void tell(const std::vector<double> &costs);
+
+  const Eigen::VectorXd &getMean() { return mean_; }
+  double getSigma() { return sigma_; }
+  std::size_t getPopulationSize() { return lambda_; }
+};
+
+struct TunedCost {
+  // Name of the cost component in the stage cost stacks
+  std::string name;
+  // Weight diagonal the multipliers apply to
+  Eigen::VectorXd diagonal;
+};
+
+struct EpisodeStatistics {
+  std::size_t ticks = 0;
+  // Sums over the ticks of the squared error between the world base
+  // velocity and the command, and of the squared first control
+  double tracking_error = 0;
+  double effort = 0;
+  // Duration of MPC::iterate [s]
+  double mean_solve_time = 0;
+  double max_solve_time = 0;
+  std::size_t rejected_solutions = 0;
+  // The state left the valid domain and the episode was stopped
+  bool diverged = false;
+};
+
+struct TuningSettings {
+  std::size_t generations = 20;
+  // 0 picks the CMA-ES default
+  std::size_t population_size = 0;
+  // Number of MPC ticks per episode
+  std::size_t episode_length = 200;
+  // Velocity command of the episodes
+  Eigen::VectorXd velocity_base = Eigen::VectorXd::Zero(6);
+  // Initial step size and bound of the log-multipliers
+  double initial_step = 0.5;
+  double max_log_multiplier = 3;
+  // 0 uses all the OpenMP threads
+  int num_threads = 0;
+  unsigned int seed = 0;
+};
+
+struct TuningResult {
+  Eigen::VectorXd best_parameters;
+  double best_objective;
+  EpisodeStatistics best_statistics;
+  // Tuned diagonals of the best candidate
+  std::map<std::string, Eigen::VectorXd> best_weights;
+  // Best objective of each generation
+  std::vector<double> history;
+};
+
+class WeightTuner {
+public:
+  // Builds an independent MPC (its own handler and problem), with the
+  // walking cycle generated. Called once per thread.
+  using MPCFactory = std::function<std::shared_ptr<MPC>()>;
+  // Advances the state x = [q; v] of the robot by one MPC period, after
+  // iterate was called on it
+  using Plant = std::function<void(MPC &, Eigen::VectorXd &)>;
+  using Objective = std::function<double(const EpisodeStatistics &)>;
+
+protected:
+  TuningSettings settings_;
+  std::vector<TunedCost> costs_;
+  Objective objective_;
+  Plant plant_;
+  std::vector<std::shared_ptr<MPC>> workers_;
+  // Initial state of the episodes
+  Eigen::VectorXd x0_;
+  std::size_t num_parameters_ = 0;
+
+public:
+  WeightTuner(const TuningSettings &settings, const MPCFactory &factory,
+              const std::vector<TunedCost> &costs, const Objective &objective,
+              const Plant &plant = predictionPlant);
+
+  // Run CMA-ES from the nominal weights (theta = 0)
+  TuningResult optimize();
+
+  // Run one episode with the given log-multipliers on the MPC of a worker
+  EpisodeStatistics runEpisode(const Eigen::VectorXd &parameters,
+                               const std::size_t worker = 0);
+
+  // Diagonal of each tuned cost for the given log-multipliers
+  std::map<std::string, Eigen::VectorXd>
+  getWeights(const Eigen::VectorXd &parameters) const;
+
+  std::size_t getNumParameters() const { return num_parameters_; }
+  MPC &getWorker(const std::size_t i) { return *workers_.at(i); }
+
+  // The robot follows the plan exactly: x becomes xs_[1]. Only meaningful
+  // for problems whose state is [q; v], i.e. full and kinodynamics.
+  static void predictionPlant(MPC &mpc, Eigen::VectorXd &x);
+  // Tracking error plus a small effort term, diverged episodes are
+  // penalized
+  static double defaultObjective(const EpisodeStatistics &stats);
+};
+
+} // namespace simple_mpc
+
+/* --- Details -------------------------------------------------------------- */
+/* --- Details -------------------------------------------------------------- */
+/* --- Details -------------------------------------------------------------- */
+
+#endif // SIMPLE_MPC_WEIGHT_TUNING_HPP_
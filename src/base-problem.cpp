@@ -11,6 +11,10 @@ Problem::Problem(const RobotHandler &handler) : handler_(handler) {
   nv_ = handler_.getModel().nv;
   ndx_ = 2 * handler_.getModel().nv;
   nu_ = nv_ - 6;
+  for (auto const &name : handler_.getFeetNames()) {
+    pose_cost_names_.insert({name, name + "_pose_cost"});
+    force_cost_names_.insert({name, name + "_force_cost"});
+  }
 }
 
 std::vector<xyz::polymorphic<StageModel>> Problem::createStages(
@@ -62,6 +66,105 @@ const Eigen::VectorXd Problem::getReferenceControl(const std::size_t t) {
   return qc->getTarget();
 }
 
+void Problem::setCostWeights(const std::string &cost_name,
+                             const Eigen::MatrixXd &weights) {
+  const CostStack::CostKey key(cost_name);
+  // A mismatch on any stage must leave the problem as it was
+  bool found = false;
+  for (auto &stage : problem_->stages_) {
+    found |= checkStageCostWeights(*stage, key, weights);
+  }
+  if (!found) {
+    throw std::runtime_error("No stage has a cost named " + cost_name);
+  }
+  for (auto &stage : problem_->stages_) {
+    setStageCostWeights(*stage, key, weights);
+  }
+}
+
+QuadraticResidualCost *
+Problem::getQuadraticCost(StageModel &stage, const CostStack::CostKey &key,
+                          const long rows, const long cols) {
+  CostStack *cs = dynamic_cast<CostStack *>(&*stage.cost_);
+  if (cs == nullptr) {
+    throw std::runtime_error("Stage cost is not a cost stack");
+  }
+  auto it = cs->components_.find(key);
+  if (it == cs->components_.end())
+    return nullptr;
+
+  QuadraticResidualCost *qrc =
+      dynamic_cast<QuadraticResidualCost *>(&*it->second.first);
+  if (qrc == nullptr) {
+    throw std::runtime_error("Cost component is not a quadratic cost");
+  }
+  if (qrc->weights_.rows() != rows or qrc->weights_.cols() != cols) {
+    throw std::runtime_error(
+        "Weights do not have the dimension of the cost component");
+  }
+  return qrc;
+}
+
+bool Problem::checkStageCostWeights(StageModel &stage,
+                                    const CostStack::CostKey &key,
+                                    const Eigen::MatrixXd &weights) {
+  return getQuadraticCost(stage, key, weights.rows(), weights.cols()) !=
+         nullptr;
+}
+
+bool Problem::setStageCostWeights(StageModel &stage,
+                                  const CostStack::CostKey &key,
+                                  const Eigen::MatrixXd &weights) {
+  QuadraticResidualCost *qrc =
+      getQuadraticCost(stage, key, weights.rows(), weights.cols());
+  if (qrc == nullptr)
+    return false;
+  // Same-size assignment, no reallocation
+  qrc->weights_ = weights;
+
+  return true;
+}
+
+void Problem::updateStageInertias(StageModel & /*stage*/,
+                                  const double /*force_scale*/) {
+  throw std::runtime_error(
+      "Inertia update is not implemented for this problem");
+}
+
+void Problem::updateInertias(const double force_scale) {
+  for (auto &stage : problem_->stages_) {
+    updateStageInertias(*stage, force_scale);
+  }
+  updateCostInertias(*getTerminalCostStack());
+
+  const pinocchio::Model &model = handler_.getModel();
+  auto &constraints = problem_->term_cstrs_;
+  for (std::size_t i = 0; i < constraints.size(); i++) {
+    if (auto *com =
+            constraints.getConstraint<CenterOfMassTranslationResidual>(i))
+      com->pin_model_.inertias = model.inertias;
+    else if (auto *dcm = constraints.getConstraint<DCMPositionResidual>(i))
+      dcm->pin_model_.inertias = model.inertias;
+  }
+}
+
+void Problem::scaleStage(StageModel &stage, const double factor) {
+  if (IntegratorSemiImplEuler *dyn =
+          dynamic_cast<IntegratorSemiImplEuler *>(&*stage.dynamics_)) {
+    dyn->timestep_ *= factor;
+  } else if (IntegratorEuler *dyn =
+                 dynamic_cast<IntegratorEuler *>(&*stage.dynamics_)) {
+    dyn->timestep_ *= factor;
+  } else {
+    throw std::runtime_error("Stage dynamics is not an Euler integrator");
+  }
+
+  CostStack *cs = dynamic_cast<CostStack *>(&*stage.cost_);
+  for (auto &component : cs->components_) {
+    component.second.second *= factor;
+  }
+}
+
 CostStack *Problem::getCostStack(std::size_t t) {
   if (t >= problem_->stages_.size()) {
     throw std::runtime_error("Stage index exceeds stage vector size");
@@ -280,6 +280,34 @@ CostStack CentroidalProblem::createTerminalCost() {
   return term_cost;
 }
 
+void CentroidalProblem::updateCostInertias(CostStack &cs) {
+  for (auto &component : cs.components_) {
+    QuadraticResidualCost *qrc =
+        dynamic_cast<QuadraticResidualCost *>(&*component.second.first);
+    if (qrc == nullptr)
+      continue;
+    if (auto *linear = qrc->getResidual<CentroidalAccelerationResidual>())
+      linear->mass_ = handler_.getMass();
+    else if (auto *angular = qrc->getResidual<AngularAccelerationResidual>())
+      angular->mass_ = handler_.getMass();
+  }
+}
+
+void CentroidalProblem::updateStageInertias(StageModel &stage,
+                                            const double force_scale) {
+  CostStack *cs = dynamic_cast<CostStack *>(&*stage.cost_);
+  updateCostInertias(*cs);
+
+  // The control is made of the contact forces
+  QuadraticControlCost *qc =
+      cs->getComponent<QuadraticControlCost>("control_cost");
+  qc->setTarget(qc->getTarget() * force_scale);
+
+  CentroidalFwdDynamics *ode = stage.getDynamics<IntegratorEuler>()
+                                   ->getDynamics<CentroidalFwdDynamics>();
+  ode->mass_ = handler_.getMass();
+}
+
 void CentroidalProblem::createTerminalConstraint() {
   if (!problem_initialized_) {
     throw std::runtime_error("Create problem first!");
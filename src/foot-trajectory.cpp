@@ -13,6 +13,7 @@
 #include "simple-mpc/foot-trajectory.hpp"
 #include <Eigen/Dense>
 #include <Eigen/StdVector>
+#include <cmath>
 #include <pinocchio/spatial/se3.hpp>
 
 namespace simple_mpc {
@@ -77,6 +78,21 @@ FootTrajectory::createTrajectory(int time_to_land, point3_t &initial_trans,
   return trajectory;
 }
 
+point3_t FootTrajectory::evaluateSwing(const double s,
+                                       const point3_t &trans_init,
+                                       const point3_t &trans_final) const {
+  // Degree 8 Bernstein basis with control points 4 x init, mid, 4 x final
+  static const double binomial[9] = {1, 8, 28, 56, 70, 56, 28, 8, 1};
+  double b[9];
+  for (int i = 0; i < 9; i++)
+    b[i] = binomial[i] * std::pow(s, i) * std::pow(1. - s, 8 - i);
+
+  point3_t midpoint = trans_init * 3 / 4 + trans_final * 1 / 4;
+  midpoint[2] += swing_apex_;
+  return (b[0] + b[1] + b[2] + b[3]) * trans_init + b[4] * midpoint +
+         (b[5] + b[6] + b[7] + b[8]) * trans_final;
+}
+
 void FootTrajectory::updateTrajectory(bool update, int landing_time,
                                       const point3_t &ee_trans,
                                       const point3_t &final_trans,
@@ -85,12 +101,22 @@ void FootTrajectory::updateTrajectory(bool update, int landing_time,
     initial_poses_.at(ee_name) = ee_trans;
     final_poses_.at(ee_name) = final_trans;
   }
-  piecewise_curve swing_trajectory = defineTranslationBezier(
-      initial_poses_.at(ee_name), final_poses_.at(ee_name));
+  const point3_t &initial_pose = initial_poses_.at(ee_name);
+  const point3_t &final_pose = final_poses_.at(ee_name);
 
-  references_.at(ee_name) =
-      createTrajectory(landing_time, initial_poses_.at(ee_name),
-                       final_poses_.at(ee_name), swing_trajectory);
+  // Same trajectory as createTrajectory on defineTranslationBezier
+  std::vector<point3_t> &reference = references_.at(ee_name);
+  reference.resize(T_);
+  for (std::size_t i = 0; i < T_; i++) {
+    int t = landing_time - (int)i;
+    if (t <= 0)
+      reference[i] = final_pose;
+    else if (t > T_fly_)
+      reference[i] = initial_pose;
+    else
+      reference[i] = evaluateSwing(double(T_fly_ - t) / double(T_fly_),
+                                   initial_pose, final_pose);
+  }
 }
 
 } // namespace simple_mpc
@@ -84,7 +84,9 @@ StageModel FullDynamicsProblem::createStage(
 
   size_t c_id = 0;
   for (auto const &name : handler_.getFeetNames()) {
-    if (settings_.force_size == 6) {
+    if (settings_.prune_stance_costs and contact_phase.at(name)) {
+      // Stance foot placement is enforced by the contact constraint
+    } else if (settings_.force_size == 6) {
       FramePlacementResidual frame_residual = FramePlacementResidual(
           space.ndx(), nu_, handler_.getModel(), contact_pose.at(name),
           handler_.getFootId(name));
@@ -136,14 +138,10 @@ StageModel FullDynamicsProblem::createStage(
   ControlErrorResidual ctrl_fn =
       ControlErrorResidual(space.ndx(), Eigen::VectorXd::Zero(nu_));
   stm.addConstraint(ctrl_fn, BoxConstraint(settings_.umin, settings_.umax));
-  StateErrorResidual state_fn = StateErrorResidual(space, nu_, space.neutral());
-  std::vector<int> state_id;
-  for (int i = 6; i < nv_; i++) {
-    state_id.push_back(i);
-  }
-  FunctionSliceXpr state_slice = FunctionSliceXpr(state_fn, state_id);
-  stm.addConstraint(state_slice,
-                    BoxConstraint(-settings_.qmax, -settings_.qmin));
+  // Same rows as the joint part of a StateErrorResidual on the neutral
+  // state, with a constant Jacobian
+  JointLimitResidual joint_fn = JointLimitResidual(handler_.getModel(), nu_);
+  stm.addConstraint(joint_fn, BoxConstraint(-settings_.qmax, -settings_.qmin));
 
   for (auto const &name : handler_.getFeetNames()) {
     if (settings_.force_size == 6 and contact_phase.at(name)) {
@@ -199,10 +197,10 @@ void FullDynamicsProblem::setReferencePoses(
         "pose_refs size does not match number of end effectors");
   }
 
-  CostStack *cs = getCostStack(t);
   for (auto ee_name : handler_.getFeetNames()) {
-    QuadraticResidualCost *qrc =
-        cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+    QuadraticResidualCost *qrc = getPoseCost(t, ee_name);
+    if (qrc == nullptr)
+      continue;
 
     if (settings_.force_size == 6) {
       FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
@@ -218,9 +216,9 @@ void FullDynamicsProblem::setReferencePoses(
 void FullDynamicsProblem::setReferencePose(const std::size_t t,
                                            const std::string &ee_name,
                                            const pinocchio::SE3 &pose_ref) {
-  CostStack *cs = getCostStack(t);
-  QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+  QuadraticResidualCost *qrc = getPoseCost(t, ee_name);
+  if (qrc == nullptr)
+    return;
   if (settings_.force_size == 6) {
     FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
     cfr->setReference(pose_ref);
@@ -235,7 +233,7 @@ void FullDynamicsProblem::setTerminalReferencePose(
     const std::string &ee_name, const pinocchio::SE3 &pose_ref) {
   CostStack *cs = getTerminalCostStack();
   QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+      cs->getComponent<QuadraticResidualCost>(pose_cost_names_.at(ee_name));
   if (settings_.force_size == 6) {
     FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
     cfr->setReference(pose_ref);
@@ -256,7 +254,7 @@ void FullDynamicsProblem::setReferenceForces(
   }
   for (auto ee_name : handler_.getFeetNames()) {
     QuadraticResidualCost *qrc =
-        cs->getComponent<QuadraticResidualCost>(ee_name + "_force_cost");
+        cs->getComponent<QuadraticResidualCost>(force_cost_names_.at(ee_name));
     ContactForceResidual *cfr = qrc->getResidual<ContactForceResidual>();
     cfr->setReference(force_refs.at(ee_name));
   }
@@ -267,7 +265,7 @@ void FullDynamicsProblem::setReferenceForce(const std::size_t i,
                                             const Eigen::VectorXd &force_ref) {
   CostStack *cs = getCostStack(i);
   QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_force_cost");
+      cs->getComponent<QuadraticResidualCost>(force_cost_names_.at(ee_name));
   ContactForceResidual *cfr = qrc->getResidual<ContactForceResidual>();
   cfr->setReference(force_ref);
 }
@@ -275,9 +273,11 @@ void FullDynamicsProblem::setReferenceForce(const std::size_t i,
 const pinocchio::SE3
 FullDynamicsProblem::getReferencePose(const std::size_t t,
                                       const std::string &ee_name) {
-  CostStack *cs = getCostStack(t);
-  QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+  QuadraticResidualCost *qrc = getPoseCost(t, ee_name);
+  if (qrc == nullptr) {
+    throw std::runtime_error("Stance foot " + ee_name +
+                             " has no pose cost at this stage");
+  }
   if (settings_.force_size == 6) {
     FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
     return cfr->getReference();
@@ -290,12 +290,22 @@ FullDynamicsProblem::getReferencePose(const std::size_t t,
   }
 }
 
+QuadraticResidualCost *
+FullDynamicsProblem::getPoseCost(const std::size_t t,
+                                 const std::string &ee_name) {
+  CostStack *cs = getCostStack(t);
+  auto it = cs->components_.find(pose_cost_names_.at(ee_name));
+  if (it == cs->components_.end())
+    return nullptr;
+  return dynamic_cast<QuadraticResidualCost *>(&*it->second.first);
+}
+
 const Eigen::VectorXd
 FullDynamicsProblem::getReferenceForce(const std::size_t t,
                                        const std::string &ee_name) {
   CostStack *cs = getCostStack(t);
   QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_force_cost");
+      cs->getComponent<QuadraticResidualCost>(force_cost_names_.at(ee_name));
   ContactForceResidual *cfr = qrc->getResidual<ContactForceResidual>();
   return cfr->getReference();
 }
@@ -328,6 +338,60 @@ size_t FullDynamicsProblem::getContactSupport(const std::size_t t) {
   return ode->constraint_models_.size();
 }
 
+void FullDynamicsProblem::updateCostInertias(CostStack &cs) {
+  const pinocchio::Model &model = handler_.getModel();
+  for (auto &component : cs.components_) {
+    QuadraticResidualCost *qrc =
+        dynamic_cast<QuadraticResidualCost *>(&*component.second.first);
+    if (qrc == nullptr)
+      continue;
+    if (auto *cent = qrc->getResidual<CentroidalMomentumResidual>())
+      cent->pin_model_.inertias = model.inertias;
+    else if (auto *force = qrc->getResidual<ContactForceResidual>())
+      force->pin_model_.inertias = model.inertias;
+  }
+}
+
+void FullDynamicsProblem::updateStageInertias(StageModel &stage,
+                                              const double force_scale) {
+  const pinocchio::Model &model = handler_.getModel();
+  CostStack *cs = dynamic_cast<CostStack *>(&*stage.cost_);
+  updateCostInertias(*cs);
+  for (auto const &name : handler_.getFeetNames()) {
+    auto it = cs->components_.find(force_cost_names_.at(name));
+    if (it == cs->components_.end())
+      continue;
+    ContactForceResidual *cfr =
+        dynamic_cast<QuadraticResidualCost *>(&*it->second.first)
+            ->getResidual<ContactForceResidual>();
+    cfr->setReference(cfr->getReference() * force_scale);
+  }
+
+  // The dynamics read the inertias from the model held by their phase
+  // space, which cannot be modified: they are rebuilt on the updated model
+  // with the same contacts and timestep. Data created before must be created
+  // again from the stage.
+  IntegratorSemiImplEuler *integrator =
+      stage.getDynamics<IntegratorSemiImplEuler>();
+  MultibodyConstraintFwdDynamics *ode =
+      integrator->getDynamics<MultibodyConstraintFwdDynamics>();
+  MultibodyConstraintFwdDynamics updated_ode(MultibodyPhaseSpace(model),
+                                             actuation_matrix_,
+                                             ode->constraint_models_,
+                                             prox_settings_);
+  stage.dynamics_ = IntegratorSemiImplEuler(updated_ode, integrator->timestep_);
+
+  for (std::size_t i = 0; i < stage.constraints_.size(); i++) {
+    if (auto *wrench =
+            stage.constraints_.getConstraint<MultibodyWrenchConeResidual>(i))
+      wrench->pin_model_.inertias = model.inertias;
+    else if (auto *friction = stage.constraints_
+                                  .getConstraint<MultibodyFrictionConeResidual>(
+                                      i))
+      friction->pin_model_.inertias = model.inertias;
+  }
+}
+
 CostStack FullDynamicsProblem::createTerminalCost() {
   auto ter_space = MultibodyPhaseSpace(handler_.getModel());
   auto term_cost = CostStack(ter_space, nu_);
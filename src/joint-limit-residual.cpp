@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 2-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+#include "simple-mpc/joint-limit-residual.hpp"
+#include <pinocchio/algorithm/joint-configuration.hpp>
+#include <stdexcept>
+
+namespace simple_mpc {
+
+JointLimitResidual::JointLimitResidual(const pinocchio::Model &model,
+                                       const int nu)
+    : UnaryFunction(2 * model.nv, nu, model.nv - 6) {
+  for (pinocchio::JointIndex j = 1; j < (pinocchio::JointIndex)model.njoints;
+       j++) {
+    if (model.idx_vs[j] < 6)
+      continue;
+    if (model.nqs[j] != 1 or model.nvs[j] != 1) {
+      throw std::runtime_error("Joint " + model.names[j] +
+                               " has more than one degree of freedom");
+    }
+    q_ids_.push_back(model.idx_qs[j]);
+    v_ids_.push_back(model.idx_vs[j]);
+  }
+  if ((int)v_ids_.size() != model.nv - 6) {
+    throw std::runtime_error("Model root must be a 6-dof free flyer");
+  }
+  q_neutral_ = pinocchio::neutral(model);
+}
+
+void JointLimitResidual::evaluate(const ConstVectorRef &x, Data &data) const {
+  for (std::size_t i = 0; i < q_ids_.size(); i++) {
+    data.value_[(Eigen::Index)i] = x[q_ids_[i]] - q_neutral_[q_ids_[i]];
+  }
+}
+
+std::shared_ptr<JointLimitResidual::Data>
+JointLimitResidual::createData() const {
+  std::shared_ptr<Data> data = UnaryFunction::createData();
+  data->Jx_.setZero();
+  for (std::size_t i = 0; i < v_ids_.size(); i++) {
+    data->Jx_((Eigen::Index)i, v_ids_[i]) = 1.;
+  }
+  return data;
+}
+
+} // namespace simple_mpc
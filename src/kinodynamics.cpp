@@ -25,24 +25,36 @@ StageModel KinodynamicsProblem::createStage(
     const std::map<std::string, pinocchio::SE3> &contact_pose,
     const std::map<std::string, Eigen::VectorXd> &contact_force,
     const std::map<std::string, bool> &land_constraint) {
-  auto space = MultibodyPhaseSpace(handler_.getModel());
-  auto rcost = CostStack(space, nu_);
+  // Feet with force variables in this stage, and their contacts
+  std::vector<std::size_t> force_feet;
   std::vector<bool> contact_states;
-  for (auto const &x : contact_phase) {
-    contact_states.push_back(x.second);
+  std::vector<pinocchio::FrameIndex> contact_ids;
+  for (std::size_t i = 0; i < handler_.getFeetNames().size(); i++) {
+    const std::string &name = handler_.getFootName(i);
+    if (settings_.active_forces_only and !contact_phase.at(name))
+      continue;
+    force_feet.push_back(i);
+    contact_states.push_back(contact_phase.at(name));
+    contact_ids.push_back(handler_.getFootId(name));
   }
+  const int nu = nv_ - 6 + settings_.force_size * (int)contact_ids.size();
+
+  auto space = MultibodyPhaseSpace(handler_.getModel());
+  auto rcost = CostStack(space, nu);
 
   computeControlFromForces(contact_force);
 
   auto cent_mom = CentroidalMomentumResidual(
-      space.ndx(), nu_, handler_.getModel(), Eigen::VectorXd::Zero(6));
+      space.ndx(), nu, handler_.getModel(), Eigen::VectorXd::Zero(6));
   auto centder_mom = CentroidalMomentumDerivativeResidual(
       space.ndx(), handler_.getModel(), settings_.gravity, contact_states,
-      handler_.getFeetIds(), settings_.force_size);
+      contact_ids, settings_.force_size);
   rcost.addCost("state_cost",
-                QuadraticStateCost(space, nu_, x0_, settings_.w_x));
+                QuadraticStateCost(space, nu, x0_, settings_.w_x));
   rcost.addCost("control_cost",
-                QuadraticControlCost(space, control_ref_, settings_.w_u));
+                QuadraticControlCost(space,
+                                     reduceControl(force_feet, control_ref_),
+                                     reduceWeights(force_feet, settings_.w_u)));
   rcost.addCost("centroidal_cost",
                 QuadraticResidualCost(space, cent_mom, settings_.w_cent));
   rcost.addCost("centroidal_derivative_cost",
@@ -51,7 +63,7 @@ StageModel KinodynamicsProblem::createStage(
   for (auto const &name : handler_.getFeetNames()) {
     if (settings_.force_size == 6) {
       FramePlacementResidual frame_residual = FramePlacementResidual(
-          space.ndx(), nu_, handler_.getModel(), contact_pose.at(name),
+          space.ndx(), nu, handler_.getModel(), contact_pose.at(name),
           handler_.getFootId(name));
 
       rcost.addCost(
@@ -59,7 +71,7 @@ StageModel KinodynamicsProblem::createStage(
           QuadraticResidualCost(space, frame_residual, settings_.w_frame));
     } else {
       FrameTranslationResidual frame_residual = FrameTranslationResidual(
-          space.ndx(), nu_, handler_.getModel(),
+          space.ndx(), nu, handler_.getModel(),
           contact_pose.at(name).translation(), handler_.getFootId(name));
 
       rcost.addCost(
@@ -70,36 +82,33 @@ StageModel KinodynamicsProblem::createStage(
 
   KinodynamicsFwdDynamics ode = KinodynamicsFwdDynamics(
       space, handler_.getModel(), settings_.gravity, contact_states,
-      handler_.getFeetIds(), settings_.force_size);
+      contact_ids, settings_.force_size);
   IntegratorSemiImplEuler dyn_model =
       IntegratorSemiImplEuler(ode, settings_.DT);
 
   StageModel stm = StageModel(rcost, dyn_model);
-  StateErrorResidual state_fn = StateErrorResidual(space, nu_, space.neutral());
-  std::vector<int> state_id;
-  for (int i = 6; i < nv_; i++) {
-    state_id.push_back(i);
-  }
-  FunctionSliceXpr state_slice = FunctionSliceXpr(state_fn, state_id);
-  stm.addConstraint(state_slice,
-                    BoxConstraint(-settings_.qmax, -settings_.qmin));
+  // Same rows as the joint part of a StateErrorResidual on the neutral
+  // state, with a constant Jacobian
+  JointLimitResidual joint_fn = JointLimitResidual(handler_.getModel(), nu);
+  stm.addConstraint(joint_fn, BoxConstraint(-settings_.qmax, -settings_.qmin));
 
   Motion v_ref = Motion::Zero();
+  // Index of the force of each foot in the control
   int i = 0;
   for (auto const &name : handler_.getFeetNames()) {
     if (contact_phase.at(name)) {
       FrameVelocityResidual frame_vel =
-          FrameVelocityResidual(space.ndx(), nu_, handler_.getModel(), v_ref,
+          FrameVelocityResidual(space.ndx(), nu, handler_.getModel(), v_ref,
                                 handler_.getFootId(name), pinocchio::LOCAL);
       if (settings_.force_size == 6) {
         CentroidalWrenchConeResidual wrench_residual =
-            CentroidalWrenchConeResidual(space.ndx(), nu_, i, settings_.mu,
+            CentroidalWrenchConeResidual(space.ndx(), nu, i, settings_.mu,
                                          settings_.Lfoot, settings_.Wfoot);
         stm.addConstraint(wrench_residual, NegativeOrthant());
         stm.addConstraint(frame_vel, EqualityConstraint());
       } else {
         CentroidalFrictionConeResidual friction_residual =
-            CentroidalFrictionConeResidual(space.ndx(), nu_, i, settings_.mu,
+            CentroidalFrictionConeResidual(space.ndx(), nu, i, settings_.mu,
                                            1e-4);
         // stm.addConstraint(friction_residual, NegativeOrthant());
         std::vector<int> vel_id = {0, 1, 2};
@@ -110,7 +119,7 @@ StageModel KinodynamicsProblem::createStage(
           std::vector<int> frame_id = {2};
 
           FrameTranslationResidual frame_residual = FrameTranslationResidual(
-              space.ndx(), nu_, handler_.getModel(),
+              space.ndx(), nu, handler_.getModel(),
               contact_pose.at(name).translation(), handler_.getFootId(name));
 
           FunctionSliceXpr frame_slice =
@@ -119,8 +128,10 @@ StageModel KinodynamicsProblem::createStage(
           stm.addConstraint(frame_slice, EqualityConstraint());
         }
       }
+      i++;
+    } else if (!settings_.active_forces_only) {
+      i++;
     }
-    i++;
   }
 
   return stm;
@@ -131,7 +142,7 @@ void KinodynamicsProblem::setReferencePose(const std::size_t t,
                                            const pinocchio::SE3 &pose_ref) {
   CostStack *cs = getCostStack(t);
   QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+      cs->getComponent<QuadraticResidualCost>(pose_cost_names_.at(ee_name));
   if (settings_.force_size == 6) {
     FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
     cfr->setReference(pose_ref);
@@ -153,7 +164,7 @@ void KinodynamicsProblem::setReferencePoses(
   CostStack *cs = getCostStack(t);
   for (auto ee_name : handler_.getFeetNames()) {
     QuadraticResidualCost *qrc =
-        cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+        cs->getComponent<QuadraticResidualCost>(pose_cost_names_.at(ee_name));
     if (settings_.force_size == 6) {
       FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
       cfr->setReference(pose_refs.at(ee_name));
@@ -169,7 +180,7 @@ void KinodynamicsProblem::setTerminalReferencePose(
     const std::string &ee_name, const pinocchio::SE3 &pose_ref) {
   CostStack *cs = getTerminalCostStack();
   QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+      cs->getComponent<QuadraticResidualCost>(pose_cost_names_.at(ee_name));
   if (settings_.force_size == 6) {
     FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
     cfr->setReference(pose_ref);
@@ -185,7 +196,7 @@ KinodynamicsProblem::getReferencePose(const std::size_t t,
                                       const std::string &ee_name) {
   CostStack *cs = getCostStack(t);
   QuadraticResidualCost *qrc =
-      cs->getComponent<QuadraticResidualCost>(ee_name + "_pose_cost");
+      cs->getComponent<QuadraticResidualCost>(pose_cost_names_.at(ee_name));
   if (settings_.force_size == 6) {
     FramePlacementResidual *cfr = qrc->getResidual<FramePlacementResidual>();
     return cfr->getReference();
@@ -214,7 +225,11 @@ void KinodynamicsProblem::setReferenceForces(
     const std::size_t i,
     const std::map<std::string, Eigen::VectorXd> &force_refs) {
   computeControlFromForces(force_refs);
-  setReferenceControl(i, control_ref_);
+  if (settings_.active_forces_only)
+    setReferenceControl(
+        i, reduceControl(getForceFeet(*problem_->stages_[i]), control_ref_));
+  else
+    setReferenceControl(i, control_ref_);
 }
 
 void KinodynamicsProblem::setReferenceForce(const std::size_t i,
@@ -226,7 +241,12 @@ void KinodynamicsProblem::setReferenceForce(const std::size_t i,
   long id = it - hname.begin();
   control_ref_.segment(id * settings_.force_size, settings_.force_size) =
       force_ref;
-  setReferenceControl(i, control_ref_);
+  // The force of a foot without force variables in stage i is dropped
+  if (settings_.active_forces_only)
+    setReferenceControl(
+        i, reduceControl(getForceFeet(*problem_->stages_[i]), control_ref_));
+  else
+    setReferenceControl(i, control_ref_);
 }
 
 const Eigen::VectorXd
@@ -237,8 +257,102 @@ KinodynamicsProblem::getReferenceForce(const std::size_t i,
       std::find(hname.begin(), hname.end(), ee_name);
   long id = it - hname.begin();
 
-  return getReferenceControl(i).segment(id * settings_.force_size,
-                                        settings_.force_size);
+  return getFullControl(i, getReferenceControl(i))
+      .segment(id * settings_.force_size, settings_.force_size);
+}
+
+std::vector<std::size_t>
+KinodynamicsProblem::getForceFeet(StageModel &stage) {
+  KinodynamicsFwdDynamics *ode =
+      stage.getDynamics<IntegratorSemiImplEuler>()
+          ->getDynamics<KinodynamicsFwdDynamics>();
+  std::vector<std::size_t> force_feet;
+  for (auto const id : ode->contact_ids_) {
+    for (std::size_t i = 0; i < handler_.getFeetIds().size(); i++) {
+      if (handler_.getFeetIds()[i] == id)
+        force_feet.push_back(i);
+    }
+  }
+  return force_feet;
+}
+
+std::vector<Eigen::Index> KinodynamicsProblem::getControlIndices(
+    const std::vector<std::size_t> &force_feet) {
+  std::vector<Eigen::Index> ids;
+  for (auto const foot : force_feet) {
+    for (int k = 0; k < settings_.force_size; k++)
+      ids.push_back((long)foot * settings_.force_size + k);
+  }
+  long joints_start =
+      settings_.force_size * (long)handler_.getFeetNames().size();
+  for (long k = 0; k < nv_ - 6; k++)
+    ids.push_back(joints_start + k);
+  return ids;
+}
+
+Eigen::VectorXd
+KinodynamicsProblem::reduceControl(const std::vector<std::size_t> &force_feet,
+                                   const Eigen::VectorXd &u_full) {
+  std::vector<Eigen::Index> ids = getControlIndices(force_feet);
+  Eigen::VectorXd u((long)ids.size());
+  for (std::size_t k = 0; k < ids.size(); k++)
+    u[(long)k] = u_full[ids[k]];
+  return u;
+}
+
+Eigen::MatrixXd
+KinodynamicsProblem::reduceWeights(const std::vector<std::size_t> &force_feet,
+                                   const Eigen::MatrixXd &w_full) {
+  std::vector<Eigen::Index> ids = getControlIndices(force_feet);
+  Eigen::MatrixXd w((long)ids.size(), (long)ids.size());
+  for (std::size_t i = 0; i < ids.size(); i++) {
+    for (std::size_t j = 0; j < ids.size(); j++)
+      w((long)i, (long)j) = w_full(ids[i], ids[j]);
+  }
+  return w;
+}
+
+Eigen::VectorXd KinodynamicsProblem::getFullControl(const std::size_t t,
+                                                    const Eigen::VectorXd &u) {
+  if (!settings_.active_forces_only)
+    return u;
+  std::vector<Eigen::Index> ids =
+      getControlIndices(getForceFeet(*problem_->stages_[t]));
+  if ((std::size_t)u.size() != ids.size()) {
+    throw std::runtime_error("Control does not have the size of stage " +
+                             std::to_string(t));
+  }
+  Eigen::VectorXd u_full = Eigen::VectorXd::Zero(nu_);
+  for (std::size_t k = 0; k < ids.size(); k++)
+    u_full[ids[k]] = u[(long)k];
+  return u_full;
+}
+
+bool KinodynamicsProblem::setStageCostWeights(StageModel &stage,
+                                              const CostStack::CostKey &key,
+                                              const Eigen::MatrixXd &weights) {
+  // Control weights are given for the full control, keep the block of the
+  // stage variables
+  if (!settings_.active_forces_only or
+      key != CostStack::CostKey("control_cost") or weights.rows() != nu_ or
+      weights.cols() != nu_)
+    return Base::setStageCostWeights(stage, key, weights);
+
+  return Base::setStageCostWeights(
+      stage, key, reduceWeights(getForceFeet(stage), weights));
+}
+
+bool KinodynamicsProblem::checkStageCostWeights(
+    StageModel &stage, const CostStack::CostKey &key,
+    const Eigen::MatrixXd &weights) {
+  if (!settings_.active_forces_only or
+      key != CostStack::CostKey("control_cost") or weights.rows() != nu_ or
+      weights.cols() != nu_)
+    return Base::checkStageCostWeights(stage, key, weights);
+
+  // The reduced weights have the size of the stage control
+  const long nu = (long)stage.nu();
+  return getQuadraticCost(stage, key, nu, nu) != nullptr;
 }
 
 const Eigen::VectorXd
@@ -289,6 +403,43 @@ CostStack KinodynamicsProblem::createTerminalCost() {
   return term_cost;
 }
 
+void KinodynamicsProblem::updateCostInertias(CostStack &cs) {
+  const pinocchio::Model &model = handler_.getModel();
+  for (auto &component : cs.components_) {
+    QuadraticResidualCost *qrc =
+        dynamic_cast<QuadraticResidualCost *>(&*component.second.first);
+    if (qrc == nullptr)
+      continue;
+    if (auto *cent = qrc->getResidual<CentroidalMomentumResidual>()) {
+      cent->pin_model_.inertias = model.inertias;
+    } else if (auto *centder =
+                   qrc->getResidual<CentroidalMomentumDerivativeResidual>()) {
+      centder->pin_model_.inertias = model.inertias;
+      centder->mass_ = handler_.getMass();
+    }
+  }
+}
+
+void KinodynamicsProblem::updateStageInertias(StageModel &stage,
+                                              const double force_scale) {
+  CostStack *cs = dynamic_cast<CostStack *>(&*stage.cost_);
+  updateCostInertias(*cs);
+
+  // Forces come first in the control
+  QuadraticControlCost *qc =
+      cs->getComponent<QuadraticControlCost>("control_cost");
+  Eigen::VectorXd u_ref = qc->getTarget();
+  u_ref.head((long)getForceFeet(stage).size() * settings_.force_size) *=
+      force_scale;
+  qc->setTarget(u_ref);
+
+  KinodynamicsFwdDynamics *ode =
+      stage.getDynamics<IntegratorSemiImplEuler>()
+          ->getDynamics<KinodynamicsFwdDynamics>();
+  ode->pin_model_.inertias = handler_.getModel().inertias;
+  ode->mass_ = handler_.getMass();
+}
+
 void KinodynamicsProblem::createTerminalConstraint() {
   if (!problem_initialized_) {
     throw std::runtime_error("Create problem first!");
@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 2-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+#include "simple-mpc/lowlevel-batch.hpp"
+
+namespace simple_mpc {
+
+IDBatchSolver::IDBatchSolver() {}
+
+IDBatchSolver::IDBatchSolver(const IDSettings &settings,
+                             const pinocchio::Model &model,
+                             const std::size_t batch_size,
+                             const int num_threads) {
+  initialize(settings, model, batch_size, num_threads);
+}
+
+void IDBatchSolver::initialize(const IDSettings &settings,
+                               const pinocchio::Model &model,
+                               const std::size_t batch_size,
+                               const int num_threads) {
+  long force_dim = settings.force_size * (long)settings.contact_ids.size();
+  num_threads_ = num_threads;
+  // One QP per instance, copies would share it. The model is read-only and
+  // shared by all instances
+  auto shared_model = std::make_shared<const pinocchio::Model>(model);
+  solvers_.clear();
+  solvers_.reserve(batch_size);
+  for (std::size_t i = 0; i < batch_size; i++)
+    solvers_.emplace_back(settings, shared_model);
+  v_.assign(batch_size, Eigen::VectorXd::Zero(model.nv));
+  a_.assign(batch_size, Eigen::VectorXd::Zero(model.nv));
+  forces_.assign(batch_size, Eigen::VectorXd::Zero(force_dim));
+
+  solved_forces_ = Eigen::MatrixXd::Zero(force_dim, (long)batch_size);
+  solved_acc_ = Eigen::MatrixXd::Zero(model.nv, (long)batch_size);
+  solved_torque_ = Eigen::MatrixXd::Zero(model.nv - 6, (long)batch_size);
+}
+
+void IDBatchSolver::solve(std::vector<pinocchio::Data> &datas,
+                          const std::vector<std::vector<bool>> &contact_states,
+                          const Eigen::MatrixXd &v, const Eigen::MatrixXd &a,
+                          const Eigen::MatrixXd &forces) {
+  long n = (long)solvers_.size();
+  if (datas.size() != solvers_.size() or
+      contact_states.size() != solvers_.size() or v.cols() != n or
+      a.cols() != n or forces.cols() != n) {
+    throw std::runtime_error("Batch inputs must have one entry per instance");
+  }
+
+#pragma omp parallel for num_threads(num_threads_) schedule(static)
+  for (long i = 0; i < n; i++) {
+    std::size_t k = (std::size_t)i;
+    v_[k] = v.col(i);
+    a_[k] = a.col(i);
+    forces_[k] = forces.col(i);
+    solvers_[k].solve_qp(datas[k], contact_states[k], v_[k], a_[k],
+                         forces_[k], datas[k].M);
+    solved_forces_.col(i) = solvers_[k].solved_forces_;
+    solved_acc_.col(i) = solvers_[k].solved_acc_;
+    solved_torque_.col(i) = solvers_[k].solved_torque_;
+  }
+}
+
+IKIDBatchSolver::IKIDBatchSolver() {}
+
+IKIDBatchSolver::IKIDBatchSolver(const IKIDSettings &settings,
+                                 const pinocchio::Model &model,
+                                 const std::size_t batch_size,
+                                 const int num_threads) {
+  initialize(settings, model, batch_size, num_threads);
+}
+
+void IKIDBatchSolver::initialize(const IKIDSettings &settings,
+                                 const pinocchio::Model &model,
+                                 const std::size_t batch_size,
+                                 const int num_threads) {
+  long force_dim = settings.force_size * (long)settings.contact_ids.size();
+  num_threads_ = num_threads;
+  // One QP per instance, copies would share it. The model is read-only and
+  // shared by all instances
+  auto shared_model = std::make_shared<const pinocchio::Model>(model);
+  solvers_.clear();
+  solvers_.reserve(batch_size);
+  for (std::size_t i = 0; i < batch_size; i++)
+    solvers_.emplace_back(settings, shared_model);
+  x_measured_.assign(batch_size, Eigen::VectorXd::Zero(model.nq + model.nv));
+  v_.assign(batch_size, Eigen::VectorXd::Zero(model.nv));
+  forces_.assign(batch_size, Eigen::VectorXd::Zero(force_dim));
+  dH_.assign(batch_size, Eigen::VectorXd::Zero(6));
+
+  solved_forces_ = Eigen::MatrixXd::Zero(force_dim, (long)batch_size);
+  solved_acc_ = Eigen::MatrixXd::Zero(model.nv, (long)batch_size);
+  solved_torque_ = Eigen::MatrixXd::Zero(model.nv - 6, (long)batch_size);
+}
+
+void IKIDBatchSolver::solve(
+    std::vector<pinocchio::Data> &datas,
+    const std::vector<std::vector<bool>> &contact_states,
+    const Eigen::MatrixXd &x_measured, const Eigen::MatrixXd &forces,
+    const Eigen::MatrixXd &dH,
+    const std::vector<std::vector<pinocchio::SE3>> &foot_refs,
+    const std::vector<std::vector<pinocchio::SE3>> &foot_refs_next) {
+  long n = (long)solvers_.size();
+  if (datas.size() != solvers_.size() or
+      contact_states.size() != solvers_.size() or
+      foot_refs.size() != solvers_.size() or
+      foot_refs_next.size() != solvers_.size() or x_measured.cols() != n or
+      forces.cols() != n or dH.cols() != n) {
+    throw std::runtime_error("Batch inputs must have one entry per instance");
+  }
+
+#pragma omp parallel for num_threads(num_threads_) schedule(static)
+  for (long i = 0; i < n; i++) {
+    std::size_t k = (std::size_t)i;
+    x_measured_[k] = x_measured.col(i);
+    v_[k] = x_measured_[k].tail(v_[k].size());
+    forces_[k] = forces.col(i);
+    dH_[k] = dH.col(i);
+    solvers_[k].computeDifferences(datas[k], x_measured_[k], foot_refs[k],
+                                   foot_refs_next[k]);
+    solvers_[k].solve_qp(datas[k], contact_states[k], v_[k], forces_[k],
+                         dH_[k], datas[k].M);
+    solved_forces_.col(i) = solvers_[k].solved_forces_;
+    solved_acc_.col(i) = solvers_[k].solved_acc_;
+    solved_torque_.col(i) = solvers_[k].solved_torque_;
+  }
+}
+
+} // namespace simple_mpc
@@ -6,6 +6,7 @@
 // All rights reserved.
 ///////////////////////////////////////////////////////////////////////////////
 #include "simple-mpc/lowlevel-control.hpp"
+#include <chrono>
 #include <proxsuite/proxqp/settings.hpp>
 
 namespace simple_mpc {
@@ -16,16 +17,26 @@ IDSolver::IDSolver(const IDSettings &settings, const pinocchio::Model &model) {
   initialize(settings, model);
 }
 
+IDSolver::IDSolver(const IDSettings &settings,
+                   std::shared_ptr<const pinocchio::Model> model) {
+  initialize(settings, model);
+}
+
 void IDSolver::initialize(const IDSettings &settings,
                           const pinocchio::Model &model) {
+  initialize(settings, std::make_shared<const pinocchio::Model>(model));
+}
+
+void IDSolver::initialize(const IDSettings &settings,
+                          std::shared_ptr<const pinocchio::Model> model) {
   settings_ = settings;
   model_ = model;
 
   nk_ = (int)settings.contact_ids.size();
   force_dim_ = (int)settings.force_size * nk_;
 
-  int n = 2 * model_.nv - 6 + force_dim_;
-  int neq = model_.nv + force_dim_;
+  int n = 2 * model_->nv - 6 + force_dim_;
+  int neq = model_->nv + force_dim_;
   if (settings.force_size == 6)
     nforcein_ = 9;
   else
@@ -42,9 +53,9 @@ void IDSolver::initialize(const IDSettings &settings,
   l_.setZero();
   C_.resize(nin, n);
   C_.setZero();
-  S_.resize(model_.nv, model_.nv - 6);
+  S_.resize(model_->nv, model_->nv - 6);
   S_.setZero();
-  S_.bottomRows(model_.nv - 6).diagonal().setOnes();
+  S_.bottomRows(model_->nv - 6).diagonal().setOnes();
 
   Cmin_.resize(nforcein_, settings.force_size);
   if (settings.force_size == 3) {
@@ -58,27 +69,43 @@ void IDSolver::initialize(const IDSettings &settings,
   }
 
   for (long i = 0; i < nk_; i++) {
-    C_.block(i * nforcein_, model_.nv + i * settings_.force_size, nforcein_,
+    C_.block(i * nforcein_, model_->nv + i * settings_.force_size, nforcein_,
              settings_.force_size) = Cmin_;
   }
-  Jc_.resize(force_dim_, model_.nv);
+  Jc_.resize(force_dim_, model_->nv);
   Jc_.setZero();
   gamma_.resize(force_dim_);
   gamma_.setZero();
-  Jdot_.resize(6, model_.nv);
-  Jdot_.setZero();
+  kinematics_.initialize(*model_, settings.contact_ids, false, true);
+  useFrameKinematics(nullptr);
 
   u_ = Eigen::VectorXd::Ones(nin) * 100000;
   g_ = Eigen::VectorXd::Zero(n);
   H_ = Eigen::MatrixXd::Zero(n, n);
-  H_.topLeftCorner(model_.nv, model_.nv).diagonal() =
-      Eigen::VectorXd::Ones(model_.nv) * settings.w_acc;
-  H_.block(model_.nv, model_.nv, force_dim_, force_dim_).diagonal() =
+  H_.topLeftCorner(model_->nv, model_->nv).diagonal() =
+      Eigen::VectorXd::Ones(model_->nv) * settings.w_acc;
+  H_.block(model_->nv, model_->nv, force_dim_, force_dim_).diagonal() =
       Eigen::VectorXd::Ones(force_dim_) * settings.w_force;
 
   solved_forces_.resize(force_dim_);
-  solved_acc_.resize(model_.nv);
-  solved_torque_.resize(model_.nv - 6);
+  solved_acc_.resize(model_->nv);
+  solved_torque_.resize(model_->nv - 6);
+
+  int ny = model_->nv + force_dim_;
+  int ne = 6 + force_dim_;
+  E_ = Eigen::MatrixXd::Zero(ne, ny);
+  EW_ = Eigen::MatrixXd::Zero(ne, ny);
+  K_ = Eigen::MatrixXd::Zero(ne, ne);
+  K_ldlt_ = Eigen::LDLT<Eigen::MatrixXd>(ne);
+  e_ = Eigen::VectorXd::Zero(ne);
+  lambda_ = Eigen::VectorXd::Zero(ne);
+  y_ = Eigen::VectorXd::Zero(ny);
+  w_inv_.resize(ny);
+  w_inv_.head(model_->nv).setConstant(1. / settings.w_acc);
+  w_inv_.tail(force_dim_).setConstant(1. / settings.w_force);
+  cone_ = Eigen::VectorXd::Zero(nforcein_);
+  solve_count_ = 0;
+  closed_form_count_ = 0;
 
   qp_ = std::make_shared<proxqp::dense::QP<double>>(
       n, neq, nin, false, proxqp::HessianType::Dense,
@@ -94,6 +121,25 @@ void IDSolver::initialize(const IDSettings &settings,
   qp_->init(H_, g_, A_, b_, C_, l_, u_);
 }
 
+void IDSolver::updateModel(std::shared_ptr<const pinocchio::Model> model) {
+  if (model->nq != model_->nq or model->nv != model_->nv) {
+    throw std::runtime_error("Model must have the dimensions of the one the "
+                             "solver was initialized with");
+  }
+  model_ = model;
+}
+
+void IDSolver::useFrameKinematics(
+    std::shared_ptr<const FrameKinematicsCache> cache) {
+  // Slots are resolved here so that a missing frame fails at setup time
+  const FrameKinematicsCache &kinematics =
+      cache == nullptr ? kinematics_ : *cache;
+  contact_slots_.clear();
+  for (const FrameIndex id : settings_.contact_ids)
+    contact_slots_.push_back(kinematics.getSlot(id));
+  shared_kinematics_ = cache;
+}
+
 void IDSolver::computeMatrice(pinocchio::Data &data,
                               const std::vector<bool> &contact_state,
                               const Eigen::VectorXd &v,
@@ -101,26 +147,28 @@ void IDSolver::computeMatrice(pinocchio::Data &data,
                               const Eigen::VectorXd &forces,
                               const Eigen::MatrixXd &M) {
 
+  if (shared_kinematics_ == nullptr)
+    kinematics_.update(*model_, data);
+  const FrameKinematicsCache &kinematics =
+      shared_kinematics_ == nullptr ? kinematics_ : *shared_kinematics_;
+
   Jc_.setZero();
   gamma_.setZero();
   l_.setZero();
   C_.setZero();
   for (long i = 0; i < nk_; i++) {
-    Jdot_.setZero();
     if (contact_state[(size_t)i]) {
-      Jvel_ = getFrameVelocity(model_, data, settings_.contact_ids[(size_t)i],
-                               pinocchio::LOCAL_WORLD_ALIGNED);
-      getFrameJacobianTimeVariation(model_, data,
-                                    settings_.contact_ids[(size_t)i],
-                                    LOCAL_WORLD_ALIGNED, Jdot_);
+      std::size_t slot = contact_slots_[(size_t)i];
+      const Motion &vel = kinematics.getVelocityWorldAligned(slot);
+      const Data::Matrix6x &J = kinematics.getJacobianWorldAligned(slot);
+      const Data::Matrix6x &dJ =
+          kinematics.getJacobianTimeVariationWorldAligned(slot);
       Jc_.middleRows(i * settings_.force_size, settings_.force_size) =
-          getFrameJacobian(model_, data, settings_.contact_ids[(size_t)i],
-                           LOCAL_WORLD_ALIGNED)
-              .topRows(settings_.force_size);
+          J.topRows(settings_.force_size);
       gamma_.segment(i * settings_.force_size, settings_.force_size) =
-          Jdot_.topRows(settings_.force_size) * v;
+          dJ.topRows(settings_.force_size) * v;
       gamma_.segment(i * settings_.force_size, 3) +=
-          baum_gains_ * Jvel_.linear() + baum_gains_ * Jvel_.angular();
+          baum_gains_ * vel.linear() + baum_gains_ * vel.angular();
 
       // Friction cone inequality
       l_.segment(i * nforcein_, 5)
@@ -145,17 +193,17 @@ void IDSolver::computeMatrice(pinocchio::Data &data,
                 forces[i * settings_.force_size + 2] * settings_.Lfoot;
       }
 
-      C_.block(i * nforcein_, model_.nv + i * settings_.force_size, nforcein_,
+      C_.block(i * nforcein_, model_->nv + i * settings_.force_size, nforcein_,
                settings_.force_size) = Cmin_;
     }
   }
 
-  A_.topLeftCorner(model_.nv, model_.nv) = M;
-  A_.block(0, model_.nv, model_.nv, force_dim_) = -Jc_.transpose();
-  A_.topRightCorner(model_.nv, model_.nv - 6) = -S_;
-  A_.bottomLeftCorner(force_dim_, model_.nv) = Jc_;
+  A_.topLeftCorner(model_->nv, model_->nv) = M;
+  A_.block(0, model_->nv, model_->nv, force_dim_) = -Jc_.transpose();
+  A_.topRightCorner(model_->nv, model_->nv - 6) = -S_;
+  A_.bottomLeftCorner(force_dim_, model_->nv) = Jc_;
 
-  b_.head(model_.nv) = -data.nle - M * a + Jc_.transpose() * forces;
+  b_.head(model_->nv) = -data.nle - M * a + Jc_.transpose() * forces;
   b_.tail(force_dim_) = -gamma_ - Jc_ * a;
 }
 
@@ -165,13 +213,79 @@ void IDSolver::solve_qp(pinocchio::Data &data,
                         const Eigen::VectorXd &forces,
                         const Eigen::MatrixXd &M) {
 
+  std::chrono::steady_clock::time_point begin =
+      std::chrono::steady_clock::now();
+
   computeMatrice(data, contact_state, v, a, forces, M);
-  qp_->update(H_, g_, A_, b_, C_, l_, u_, false);
-  qp_->solve();
+  solve_count_++;
+  if (settings_.closed_form and solveClosedForm(contact_state, a, forces, M)) {
+    closed_form_count_++;
+  } else {
+    qp_->update(H_, g_, A_, b_, C_, l_, u_, false);
+    qp_->solve();
+
+    solved_acc_ = a + qp_->results.x.head(model_->nv);
+    solved_forces_ = forces + qp_->results.x.segment(model_->nv, force_dim_);
+    solved_torque_ = qp_->results.x.tail(model_->nv - 6);
+  }
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  solve_time_ = std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+bool IDSolver::solveClosedForm(const std::vector<bool> &contact_state,
+                               const Eigen::VectorXd &a,
+                               const Eigen::VectorXd &forces,
+                               const Eigen::MatrixXd &M) {
+  // Torques only appear in the actuated rows of the dynamics, which then
+  // give them back once (da, df) is known. What remains is
+  //   min w_acc |da|^2 + w_force |df|^2  s.t.  E (da, df) = e
+  // solved as y = W^-1 E^T (E W^-1 E^T)^-1 e.
+  long fs = settings_.force_size;
+  E_.topLeftCorner(6, model_->nv) = M.topRows(6);
+  E_.topRightCorner(6, force_dim_) = -Jc_.leftCols(6).transpose();
+  e_.head(6) = b_.head(6);
+  for (long i = 0; i < nk_; i++) {
+    if (contact_state[(size_t)i]) {
+      E_.middleRows(6 + i * fs, fs).leftCols(model_->nv) =
+          Jc_.middleRows(i * fs, fs);
+      E_.middleRows(6 + i * fs, fs).rightCols(force_dim_).setZero();
+      e_.segment(6 + i * fs, fs) = b_.segment(model_->nv + i * fs, fs);
+    } else {
+      E_.middleRows(6 + i * fs, fs).setZero();
+      E_.block(6 + i * fs, model_->nv + i * fs, fs, fs).diagonal().setOnes();
+      e_.segment(6 + i * fs, fs).setZero();
+    }
+  }
+
+  EW_.noalias() = E_ * w_inv_.asDiagonal();
+  K_.noalias() = EW_ * E_.transpose();
+  K_ldlt_.compute(K_);
+  if (K_ldlt_.info() != Eigen::Success or !K_ldlt_.isPositive())
+    return false;
+  lambda_ = K_ldlt_.solve(e_);
+  y_.noalias() = EW_.transpose() * lambda_;
+  if (!y_.allFinite())
+    return false;
+
+  // Friction cones, checked on the same rows as the QP
+  for (long i = 0; i < nk_; i++) {
+    if (!contact_state[(size_t)i])
+      continue;
+    cone_.noalias() = Cmin_ * y_.segment(model_->nv + i * fs, fs);
+    if ((cone_.array() < l_.segment(i * nforcein_, nforcein_).array()).any() or
+        (cone_.array() > u_.segment(i * nforcein_, nforcein_).array()).any())
+      return false;
+  }
 
-  solved_acc_ = a + qp_->results.x.head(model_.nv);
-  solved_forces_ = forces + qp_->results.x.segment(model_.nv, force_dim_);
-  solved_torque_ = qp_->results.x.tail(model_.nv - 6);
+  solved_acc_ = a + y_.head(model_->nv);
+  solved_forces_ = forces + y_.tail(force_dim_);
+  solved_torque_.noalias() =
+      M.bottomRows(model_->nv - 6) * y_.head(model_->nv) -
+      Jc_.rightCols(model_->nv - 6).transpose() * y_.tail(force_dim_) -
+      b_.segment(6, model_->nv - 6);
+
+  return true;
 }
 
 IKIDSolver::IKIDSolver() {}
@@ -181,16 +295,26 @@ IKIDSolver::IKIDSolver(const IKIDSettings &settings,
   initialize(settings, model);
 }
 
+IKIDSolver::IKIDSolver(const IKIDSettings &settings,
+                       std::shared_ptr<const pinocchio::Model> model) {
+  initialize(settings, model);
+}
+
 void IKIDSolver::initialize(const IKIDSettings &settings,
                             const pinocchio::Model &model) {
+  initialize(settings, std::make_shared<const pinocchio::Model>(model));
+}
+
+void IKIDSolver::initialize(const IKIDSettings &settings,
+                            std::shared_ptr<const pinocchio::Model> model) {
   settings_ = settings;
   model_ = model;
 
-  Jfoot_.resize(6, model_.nv);
-  Jfoot_.setZero();
-
-  dJfoot_.resize(6, model_.nv);
-  dJfoot_.setZero();
+  std::vector<FrameIndex> frame_ids = settings_.contact_ids;
+  frame_ids.insert(frame_ids.end(), settings_.fixed_frame_ids.begin(),
+                   settings_.fixed_frame_ids.end());
+  kinematics_.initialize(*model_, frame_ids, true, false);
+  useFrameKinematics(nullptr);
 
   for (size_t i = 0; i < settings_.contact_ids.size(); i++) {
     Eigen::VectorXd foot_diff(6);
@@ -211,17 +335,17 @@ void IKIDSolver::initialize(const IKIDSettings &settings,
     dframe_diff.setZero();
     dframe_diffs_.push_back(dframe_diff);
   }
-  q_diff_.resize(model_.nv);
+  q_diff_.resize(model_->nv);
   q_diff_.setZero();
-  dq_diff_.resize(model_.nv);
+  dq_diff_.resize(model_->nv);
   dq_diff_.setZero();
 
   fs_ = (int)settings.force_size;
   nk_ = (int)settings.contact_ids.size();
   force_dim_ = fs_ * nk_;
 
-  int n = 2 * model_.nv - 6 + force_dim_;
-  int neq = model_.nv + force_dim_;
+  int n = 2 * model_->nv - 6 + force_dim_;
+  int neq = model_->nv + force_dim_;
   if (settings.force_size == 6)
     nforcein_ = 9;
   else
@@ -236,17 +360,17 @@ void IKIDSolver::initialize(const IKIDSettings &settings,
   l_.setZero();
   C_.resize(nin, n);
   C_.setZero();
-  S_.resize(model_.nv, model_.nv - 6);
+  S_.resize(model_->nv, model_->nv - 6);
   S_.setZero();
-  S_.bottomRows(model_.nv - 6).diagonal().setOnes();
+  S_.bottomRows(model_->nv - 6).diagonal().setOnes();
   l_box_.resize(n);
   l_box_.setOnes();
   l_box_ *= -100000;
-  l_box_.tail(model.nv - 6) = -model.effortLimit.tail(model.nv - 6);
+  l_box_.tail(model_->nv - 6) = -model_->effortLimit.tail(model_->nv - 6);
   u_box_.resize(n);
   u_box_.setOnes();
   u_box_ *= 100000;
-  u_box_.tail(model.nv - 6) = model.effortLimit.tail(model.nv - 6);
+  u_box_.tail(model_->nv - 6) = model_->effortLimit.tail(model_->nv - 6);
 
   Cmin_.resize(nforcein_, settings.force_size);
   if (settings.force_size == 3) {
@@ -260,23 +384,23 @@ void IKIDSolver::initialize(const IKIDSettings &settings,
   }
 
   for (long i = 0; i < nk_; i++) {
-    C_.block(i * nforcein_, model_.nv + i * settings_.force_size, nforcein_,
+    C_.block(i * nforcein_, model_->nv + i * settings_.force_size, nforcein_,
              settings_.force_size) = Cmin_;
   }
-  Jframe_.resize(3, model_.nv);
-  Jframe_.setZero();
-  dJframe_.resize(6, model_.nv);
-  dJframe_.setZero();
+  Jfeet_.resize(force_dim_, model_->nv);
+  Jfeet_.setZero();
+  Jframes_.resize(3 * (long)settings_.fixed_frame_ids.size(), model_->nv);
+  Jframes_.setZero();
 
   u_ = Eigen::VectorXd::Ones(nin) * 100000;
   g_ = Eigen::VectorXd::Zero(n);
   H_ = Eigen::MatrixXd::Zero(n, n);
-  H_.block(model_.nv, model_.nv, force_dim_, force_dim_).diagonal() =
+  H_.block(model_->nv, model_->nv, force_dim_, force_dim_).diagonal() =
       Eigen::VectorXd::Ones(force_dim_) * settings.w_force;
 
   solved_forces_.resize(force_dim_);
-  solved_acc_.resize(model_.nv);
-  solved_torque_.resize(model_.nv - 6);
+  solved_acc_.resize(model_->nv);
+  solved_torque_.resize(model_->nv - 6);
 
   qp_ = std::make_shared<proxqp::dense::QP<double>>(
       n, neq, nin, true, proxqp::HessianType::Dense,
@@ -292,16 +416,44 @@ void IKIDSolver::initialize(const IKIDSettings &settings,
   qp_->init(H_, g_, A_, b_, C_, l_, u_, l_box_, u_box_);
 }
 
+void IKIDSolver::updateModel(std::shared_ptr<const pinocchio::Model> model) {
+  if (model->nq != model_->nq or model->nv != model_->nv) {
+    throw std::runtime_error("Model must have the dimensions of the one the "
+                             "solver was initialized with");
+  }
+  model_ = model;
+}
+
+void IKIDSolver::useFrameKinematics(
+    std::shared_ptr<const FrameKinematicsCache> cache) {
+  const FrameKinematicsCache &kinematics =
+      cache == nullptr ? kinematics_ : *cache;
+  contact_slots_.clear();
+  for (const FrameIndex id : settings_.contact_ids)
+    contact_slots_.push_back(kinematics.getSlot(id));
+  frame_slots_.clear();
+  for (const FrameIndex id : settings_.fixed_frame_ids)
+    frame_slots_.push_back(kinematics.getSlot(id));
+  shared_kinematics_ = cache;
+}
+
 void IKIDSolver::computeDifferences(
     pinocchio::Data &data, const Eigen::VectorXd &x_measured,
     const std::vector<pinocchio::SE3> foot_refs,
     const std::vector<pinocchio::SE3> foot_refs_next) {
-  difference(model_, x_measured.head(model_.nq), settings_.x0.head(model_.nq),
-             q_diff_);
-  dq_diff_ = settings_.x0.tail(model_.nv) - x_measured.tail(model_.nv);
+  difference(*model_, x_measured.head(model_->nq),
+             settings_.x0.head(model_->nq), q_diff_);
+  dq_diff_ = settings_.x0.tail(model_->nv) - x_measured.tail(model_->nv);
+
+  // Filled once per tick, computeMatrice reads the same values
+  if (shared_kinematics_ == nullptr)
+    kinematics_.update(*model_, data);
+  const FrameKinematicsCache &kinematics =
+      shared_kinematics_ == nullptr ? kinematics_ : *shared_kinematics_;
 
   for (size_t i = 0; i < settings_.contact_ids.size(); i++) {
     FrameIndex id = settings_.contact_ids[i];
+    const Motion &vel = kinematics.getVelocity(contact_slots_[i]);
     foot_diffs_[i].head(3) =
         foot_refs[i].translation() - data.oMf[id].translation();
     foot_diffs_[i].tail(3) =
@@ -310,17 +462,17 @@ void IKIDSolver::computeDifferences(
     dfoot_diffs_[i].head(3) =
         (foot_refs_next[i].translation() - foot_refs[i].translation()) /
             settings_.dt -
-        getFrameVelocity(model_, data, id, LOCAL).linear();
+        vel.linear();
     dfoot_diffs_[i].tail(3) =
         log3(foot_refs[i].rotation().transpose() *
              foot_refs_next[i].rotation()) /
             settings_.dt -
-        getFrameVelocity(model_, data, id, LOCAL).angular();
+        vel.angular();
   }
   for (size_t i = 0; i < settings_.fixed_frame_ids.size(); i++) {
     FrameIndex id = settings_.fixed_frame_ids[i];
     frame_diffs_[i] = -log3(data.oMf[id].rotation());
-    dframe_diffs_[i] = -getFrameVelocity(model_, data, id, LOCAL).angular();
+    dframe_diffs_[i] = -kinematics.getVelocity(frame_slots_[i]).angular();
   }
 }
 
@@ -331,52 +483,45 @@ void IKIDSolver::computeMatrice(pinocchio::Data &data,
                                 const Eigen::VectorXd &dH,
                                 const Eigen::MatrixXd &M) {
 
-  H_.topLeftCorner(model_.nv, model_.nv) =
-      settings_.w_qref * Eigen::MatrixXd::Identity(model_.nv, model_.nv);
+  const FrameKinematicsCache &kinematics =
+      shared_kinematics_ == nullptr ? kinematics_ : *shared_kinematics_;
 
-  H_.topLeftCorner(model_.nv, model_.nv) +=
-      settings_.w_centroidal * data.Ag.transpose() * data.Ag;
-
-  g_.head(model_.nv) =
+  g_.head(model_->nv) =
       settings_.w_qref * (-settings_.Kp_gains[0].cwiseProduct(q_diff_) -
                           settings_.Kd_gains[0].cwiseProduct(dq_diff_));
-  g_.head(model_.nv) -= settings_.w_centroidal *
-                        (dH - data.dAg * v_current).transpose() * data.Ag;
+  g_.head(model_->nv).noalias() -= settings_.w_centroidal *
+                                   data.Ag.transpose() *
+                                   (dH - data.dAg * v_current);
 
-  A_.topLeftCorner(model_.nv, model_.nv) = M;
-  A_.topRightCorner(model_.nv, model_.nv - 6) = -S_;
+  A_.topLeftCorner(model_->nv, model_->nv) = M;
+  A_.topRightCorner(model_->nv, model_->nv - 6) = -S_;
 
-  b_.head(model_.nv) = -data.nle;
+  b_.head(model_->nv) = -data.nle;
   b_.tail(force_dim_).setZero();
   l_.setZero();
   C_.setZero();
 
   for (size_t i = 0; i < settings_.contact_ids.size(); i++) {
-    dJfoot_.setZero();
-    FrameIndex id = settings_.contact_ids[i];
-    Jfoot_ = getFrameJacobian(model_, data, id, LOCAL);
-    getFrameJacobianTimeVariation(model_, data, id, LOCAL, dJfoot_);
-
-    H_.topLeftCorner(model_.nv, model_.nv) += settings_.w_footpose *
-                                              Jfoot_.topRows(fs_).transpose() *
-                                              Jfoot_.topRows(fs_);
-
-    g_.head(model_.nv) +=
-        settings_.w_footpose *
-        (dJfoot_.topRows(fs_) * v_current -
+    long il = (long)i;
+    std::size_t slot = contact_slots_[i];
+    const Data::Matrix6x &Jfoot = kinematics.getJacobian(slot);
+    const Data::Matrix6x &dJfoot = kinematics.getJacobianTimeVariation(slot);
+    Jfeet_.middleRows(il * fs_, fs_) = Jfoot.topRows(fs_);
+
+    g_.head(model_->nv).noalias() +=
+        settings_.w_footpose * Jfoot.topRows(fs_).transpose() *
+        (dJfoot.topRows(fs_) * v_current -
          settings_.Kp_gains[1].cwiseProduct(foot_diffs_[i].topRows(fs_)) -
-         settings_.Kd_gains[1].cwiseProduct(dfoot_diffs_[i].topRows(fs_)))
-            .transpose() *
-        Jfoot_.topRows(fs_);
+         settings_.Kd_gains[1].cwiseProduct(dfoot_diffs_[i].topRows(fs_)));
 
-    long il = (long)i;
     if (contact_state[i]) {
-      A_.block(0, model_.nv + il * fs_, model_.nv, fs_) =
-          -Jfoot_.topRows(fs_).transpose();
-      A_.block(model_.nv + il * fs_, 0, fs_, model_.nv) = Jfoot_.topRows(fs_);
-      b_.head(model_.nv) +=
-          Jfoot_.topRows(fs_).transpose() * forces.segment(il * fs_, fs_);
-      b_.segment(model_.nv + il * fs_, fs_) = -dJfoot_.topRows(fs_) * v_current;
+      A_.block(0, model_->nv + il * fs_, model_->nv, fs_) =
+          -Jfoot.topRows(fs_).transpose();
+      A_.block(model_->nv + il * fs_, 0, fs_, model_->nv) = Jfoot.topRows(fs_);
+      b_.head(model_->nv).noalias() +=
+          Jfoot.topRows(fs_).transpose() * forces.segment(il * fs_, fs_);
+      b_.segment(model_->nv + il * fs_, fs_).noalias() =
+          -dJfoot.topRows(fs_) * v_current;
 
       l_.segment(il * nforcein_, 5)
           << forces[il * fs_] - forces[il * fs_ + 2] * settings_.mu,
@@ -392,28 +537,40 @@ void IKIDSolver::computeMatrice(pinocchio::Data &data,
             -forces[il * fs_ + 4] - forces[il * fs_ + 2] * settings_.Lfoot;
       }
 
-      C_.block(il * nforcein_, model_.nv + il * fs_, nforcein_, fs_) = Cmin_;
+      C_.block(il * nforcein_, model_->nv + il * fs_, nforcein_, fs_) = Cmin_;
     } else {
-      A_.block(0, model_.nv + il * fs_, model_.nv, fs_).setZero();
-      A_.block(model_.nv + il * fs_, 0, fs_, model_.nv).setZero();
+      A_.block(0, model_->nv + il * fs_, model_->nv, fs_).setZero();
+      A_.block(model_->nv + il * fs_, 0, fs_, model_->nv).setZero();
     }
   }
 
   for (size_t i = 0; i < settings_.fixed_frame_ids.size(); i++) {
-    dJframe_.setZero();
-    FrameIndex id = settings_.fixed_frame_ids[i];
-    Jframe_ = getFrameJacobian(model_, data, id, LOCAL).bottomRows(3);
-    getFrameJacobianTimeVariation(model_, data, id, LOCAL, dJframe_);
-
-    H_.topLeftCorner(model_.nv, model_.nv) +=
-        settings_.w_baserot * Jframe_.transpose() * Jframe_;
-    g_.head(model_.nv) += settings_.w_baserot *
-                          (dJframe_.bottomRows(3) * v_current -
-                           settings_.Kp_gains[2].cwiseProduct(frame_diffs_[i]) -
-                           settings_.Kd_gains[2].cwiseProduct(dframe_diffs_[i]))
-                              .transpose() *
-                          Jframe_;
+    long il = (long)i;
+    std::size_t slot = frame_slots_[i];
+    const Data::Matrix6x &Jframe = kinematics.getJacobian(slot);
+    const Data::Matrix6x &dJframe = kinematics.getJacobianTimeVariation(slot);
+    Jframes_.middleRows(il * 3, 3) = Jframe.bottomRows(3);
+
+    g_.head(model_->nv).noalias() +=
+        settings_.w_baserot * Jframe.bottomRows(3).transpose() *
+        (dJframe.bottomRows(3) * v_current -
+         settings_.Kp_gains[2].cwiseProduct(frame_diffs_[i]) -
+         settings_.Kd_gains[2].cwiseProduct(dframe_diffs_[i]));
   }
+
+  // Hessian assembled on its lower half with one symmetric rank update per
+  // task group, then mirrored
+  auto Hqq = H_.topLeftCorner(model_->nv, model_->nv);
+  Hqq.setZero();
+  Hqq.diagonal().setConstant(settings_.w_qref);
+  Hqq.selfadjointView<Eigen::Lower>().rankUpdate(data.Ag.transpose(),
+                                                  settings_.w_centroidal);
+  Hqq.selfadjointView<Eigen::Lower>().rankUpdate(Jfeet_.transpose(),
+                                                  settings_.w_footpose);
+  if (Jframes_.rows() > 0)
+    Hqq.selfadjointView<Eigen::Lower>().rankUpdate(Jframes_.transpose(),
+                                                    settings_.w_baserot);
+  Hqq.triangularView<Eigen::StrictlyUpper>() = Hqq.transpose();
 }
 
 void IKIDSolver::solve_qp(pinocchio::Data &data,
@@ -426,9 +583,9 @@ void IKIDSolver::solve_qp(pinocchio::Data &data,
   qp_->update(H_, g_, A_, b_, C_, l_, u_, l_box_, u_box_, false);
   qp_->solve();
 
-  solved_acc_ = qp_->results.x.head(model_.nv);
-  solved_forces_ = forces + qp_->results.x.segment(model_.nv, force_dim_);
-  solved_torque_ = qp_->results.x.tail(model_.nv - 6);
+  solved_acc_ = qp_->results.x.head(model_->nv);
+  solved_forces_ = forces + qp_->results.x.segment(model_->nv, force_dim_);
+  solved_torque_ = qp_->results.x.tail(model_->nv - 6);
 }
 
 } // namespace simple_mpc
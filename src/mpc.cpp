@@ -12,12 +12,16 @@
 #include <aligator/core/workspace-base.hpp>
 #include <aligator/fwd.hpp>
 #include <aligator/solvers/proxddp/solver-proxddp.hpp>
+#include <pinocchio/algorithm/joint-configuration.hpp>
 #include <pinocchio/fwd.hpp>
 #include <proxsuite-nlp/fwd.hpp>
 
 #include "simple-mpc/mpc.hpp"
 #include "simple-mpc/robot-handler.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <limits>
 
 namespace simple_mpc {
 using namespace aligator;
@@ -33,6 +37,7 @@ void MPC::initialize(const MPCSettings &settings,
                      std::shared_ptr<Problem> problem) {
   settings_ = settings;
   problem_ = problem;
+  max_horizon_ = problem_->getSize();
   std::map<std::string, Eigen::Vector3d> starting_poses;
   for (auto const &name : problem_->getHandler().getFeetNames()) {
     starting_poses.insert(
@@ -44,22 +49,12 @@ void MPC::initialize(const MPCSettings &settings,
   }
   foot_trajectories_ =
       FootTrajectory(starting_poses, settings_.swing_apex, settings_.T_fly,
-                     settings_.T_contact, settings_.T);
+                     settings_.T_contact, getStageNode(settings_.T));
 
   foot_trajectories_.updateForward(settings.swing_apex);
   x0_ = problem_->getProblemState();
 
-  solver_ = std::make_shared<SolverProxDDP>(settings_.TOL, settings_.mu_init,
-                                            maxiters, aligator::QUIET);
-  solver_->rollout_type_ = aligator::RolloutType::LINEAR;
-
-  if (settings_.num_threads > 1) {
-    solver_->linear_solver_choice = aligator::LQSolverChoice::PARALLEL;
-    solver_->setNumThreads(settings_.num_threads);
-  } else
-    solver_->linear_solver_choice = aligator::LQSolverChoice::SERIAL;
-  solver_->force_initial_condition_ = true;
-  // solver_->reg_min = 1e-6;
+  solver_ = createSolver();
 
   ee_names_ = problem_->getHandler().getFeetNames();
   Eigen::VectorXd force_ref(
@@ -76,10 +71,16 @@ void MPC::initialize(const MPCSettings &settings,
     contact_poses.insert({name, problem_->getHandler().getFootPose(name)});
     force_map.insert({name, force_ref});
   }
+  tail_contacts_ = contact_states;
+  horizon_contacts_.assign(getHorizonNodes(), contact_states);
+  stage_patterns_.assign(problem_->getSize(),
+                         StagePattern(contact_states, land_constraint));
 
+  xs_.reserve(max_horizon_ + 1);
+  us_.reserve(max_horizon_);
   for (std::size_t i = 0; i < problem_->getProblem()->numSteps(); i++) {
     xs_.push_back(x0_);
-    us_.push_back(problem_->getReferenceControl(0));
+    us_.push_back(problem_->getReferenceControl(i));
 
     std::shared_ptr<StageModel> sm =
         std::make_shared<StageModel>(problem_->createStage(
@@ -89,170 +90,900 @@ void MPC::initialize(const MPCSettings &settings,
   }
   xs_.push_back(x0_);
 
+  if (settings_.blocking_factor > 1) {
+    for (std::size_t i = settings_.blocking_start; i < problem_->getSize();
+         i++) {
+      problem_->scaleStage(*problem_->getProblem()->stages_[i],
+                           (double)settings_.blocking_factor);
+    }
+  }
+
   solver_->setup(*problem_->getProblem());
   solver_->run(*problem_->getProblem(), xs_, us_);
 
-  xs_ = solver_->results_.xs;
-  us_ = solver_->results_.us;
-  K0_ = solver_->results_.getCtrlFeedbacks()[0];
+  xs_ = solver_->getResults().xs;
+  us_ = solver_->getResults().us;
+  getFeedback(0, K0_);
+  getFeedback(1, K1_);
+  K1_valid_ = true;
+  last_cost_ = solver_->getResults().traj_cost_;
+  xs_candidate_ = xs_;
+  us_candidate_ = us_;
+  K0_candidate_ = K0_;
+  K1_candidate_ = K1_;
 
-  solver_->max_iters = settings_.max_iters;
+  solver_->setMaxIters(settings_.max_iters);
 
   com0_ = problem_->getHandler().getComPosition();
+  mass_ = problem_->getHandler().getMass();
   now_ = WALKING;
   velocity_base_.resize(6);
   velocity_base_.setZero();
+  solved_velocity_base_ = velocity_base_;
+  state_deviation_.resize(problem_->getProblem()->stages_[0]->ndx1());
+}
+
+std::shared_ptr<OCPSolver> MPC::createSolver() {
+  return createOCPSolver(settings_.solver_backend, settings_.TOL,
+                         settings_.mu_init, maxiters, settings_.num_threads);
+}
+
+SolverProxDDP &MPC::getSolver() {
+  SolverProxDDP *solver = solver_->getProxDDP();
+  if (solver == nullptr) {
+    throw std::runtime_error("The solver backend does not use ProxDDP");
+  }
+  return *solver;
+}
+
+void MPC::reset(const Eigen::VectorXd &q_current,
+                const Eigen::VectorXd &v_current) {
+  problem_->getHandler().updateState(q_current, v_current, false);
+  x0_ = problem_->getProblemState();
+
+  // Standing stages, as left by initialize. They are copies of the stage
+  // models so the cost weights set since then are kept.
+  TrajOptProblem &problem = *problem_->getProblem();
+  for (std::size_t i = 0; i < problem.stages_.size(); i++) {
+    problem.stages_[i] = *standing_horizon_[i];
+    if (settings_.blocking_factor > 1 and i >= settings_.blocking_start)
+      problem_->scaleStage(*problem.stages_[i],
+                           (double)settings_.blocking_factor);
+  }
+  problem.setInitState(x0_);
+
+  // Ring back to its origin, with the events of a cycle just generated
+  if (!cycle_horizon_.empty()) {
+    long offset = (long)cycle_offset_;
+    std::rotate(cycle_horizon_.begin(), cycle_horizon_.end() - offset,
+                cycle_horizon_.end());
+    std::rotate(cycle_horizon_data_.begin(),
+                cycle_horizon_data_.end() - offset, cycle_horizon_data_.end());
+    std::rotate(contact_states_.begin(), contact_states_.end() - offset,
+                contact_states_.end());
+    cycle_offset_ = 0;
+  }
+  contact_plan_.clear();
+  for (auto const &name : ee_names_) {
+    foot_takeoff_times_[name].clear();
+    foot_land_times_[name].clear();
+    tail_contacts_[name] = true;
+  }
+  for (auto &contacts : horizon_contacts_) {
+    for (auto &contact : contacts)
+      contact.second = true;
+  }
+  StagePattern standing(tail_contacts_, tail_contacts_);
+  for (auto &land : standing.second)
+    land.second = false;
+  stage_patterns_.assign(problem.stages_.size(), standing);
+  if (!cycle_horizon_.empty())
+    addCycleEvents();
+
+  std::map<std::string, Eigen::Vector3d> starting_poses;
+  for (auto const &name : ee_names_) {
+    starting_poses.insert(
+        {name, problem_->getHandler().getFootPose(name).translation()});
+  }
+  foot_trajectories_ =
+      FootTrajectory(starting_poses, settings_.swing_apex, settings_.T_fly,
+                     settings_.T_contact, getHorizonNodes());
+  foot_trajectories_.updateForward(settings_.swing_apex);
+
+  // Cold start, solved to convergence as in initialize
+  for (std::size_t i = 0; i < us_.size(); i++) {
+    xs_[i] = x0_;
+    us_[i] = problem_->getReferenceControl(i);
+  }
+  xs_.back() = x0_;
+  solver_->setup(problem);
+  solver_->setMaxIters(maxiters);
+  solver_->run(problem, xs_, us_);
+  solver_->setMaxIters(settings_.max_iters);
+  xs_ = solver_->getResults().xs;
+  us_ = solver_->getResults().us;
+  getFeedback(0, K0_);
+  getFeedback(1, K1_);
+  K1_valid_ = true;
+  last_cost_ = solver_->getResults().traj_cost_;
+
+  com0_ = problem_->getHandler().getComPosition();
+  now_ = WALKING;
+  velocity_base_.setZero();
+  solved_velocity_base_ = velocity_base_;
+  solution_status_ = SOLUTION_OK;
+  rejected_solutions_ = 0;
+  solve_skipped_ = false;
+  consecutive_skips_ = 0;
+  skipped_solves_ = 0;
+  iterations_ = 0;
+  saved_solve_time_ = 0;
+  clock_started_ = false;
+  node_phase_ = 0;
 }
 
 void MPC::generateCycleHorizon(
     const std::vector<std::map<std::string, bool>> &contact_states) {
+  cycle_offset_ = 0;
   contact_states_ = contact_states;
-  for (auto const &name : ee_names_) {
-    foot_takeoff_times_.insert({name, std::vector<int>()});
-    foot_land_times_.insert({name, std::vector<int>()});
-    for (size_t i = 1; i < contact_states.size(); i++) {
-      if (!contact_states[i].at(name) and contact_states[i - 1].at(name)) {
-        foot_takeoff_times_.at(name).push_back((int)(i + problem_->getSize()));
-      }
-      if (contact_states[i].at(name) and !contact_states[i - 1].at(name)) {
-        foot_land_times_.at(name).push_back((int)(i + problem_->getSize()));
-      }
-    }
-    if (contact_states.back().at(name) and !contact_states[0].at(name))
-      foot_takeoff_times_.at(name).push_back(
-          (int)(contact_states.size() - 1 + problem_->getSize()));
-    if (!contact_states.back().at(name) and contact_states[0].at(name))
-      foot_land_times_.at(name).push_back(
-          (int)(contact_states.size() - 1 + problem_->getSize()));
+
+  // A new cycle replaces the previous one, e.g. on a gait switch. Stages
+  // already in the window keep their events, the ones of the old cycle
+  // beyond it are dropped. A queued plan keeps its events, the ones of the
+  // cycle are added when it runs out.
+  if (contact_plan_.empty()) {
+    dropFutureEvents();
+    addCycleEvents();
   }
+  buildCycleHorizon();
+}
+
+void MPC::buildCycleHorizon() {
+  cycle_horizon_.clear();
+  cycle_horizon_data_.clear();
+  const std::size_t size = contact_states_.size();
+
+  // Nodes with the same contact and landing pattern are identical and share
+  // their stage template. Data stay per entry since several entries of a
+  // pattern can be in the window at once. Landings follow the ring from
+  // its origin.
   std::map<std::string, bool> previous_contacts;
   for (auto const &name : ee_names_) {
     previous_contacts.insert({name, true});
   }
-  for (auto const &state : contact_states) {
-    int active_contacts = 0;
-    for (auto const &contact : state) {
-      if (contact.second)
-        active_contacts += 1;
+  cycle_horizon_.reserve(size);
+  cycle_horizon_data_.reserve(size);
+  for (std::size_t i = 0; i < size; i++) {
+    const std::map<std::string, bool> &state =
+        contact_states_[(i + size - cycle_offset_) % size];
+    std::map<std::string, bool> land_contacts;
+    for (auto const &name : ee_names_) {
+      land_contacts.insert(
+          {name, !previous_contacts.at(name) and state.at(name)});
     }
 
-    Eigen::VectorXd force_ref(
-        problem_->getReferenceForce(0, problem_->getHandler().getFootName(0)));
-    Eigen::VectorXd force_zero(
-        problem_->getReferenceForce(0, problem_->getHandler().getFootName(0)));
-    force_ref.setZero();
-    force_zero.setZero();
-    force_ref[2] = settings_.support_force / active_contacts;
+    std::shared_ptr<StageModel> sm =
+        getStageTemplate(state, land_contacts).model;
+    cycle_horizon_.push_back(sm);
+    cycle_horizon_data_.push_back(sm->createData());
+    previous_contacts = state;
+  }
+  std::rotate(cycle_horizon_.begin(),
+              cycle_horizon_.begin() + (long)cycle_offset_,
+              cycle_horizon_.end());
+  std::rotate(cycle_horizon_data_.begin(),
+              cycle_horizon_data_.begin() + (long)cycle_offset_,
+              cycle_horizon_data_.end());
+}
 
-    std::map<std::string, pinocchio::SE3> contact_poses;
-    std::map<std::string, Eigen::VectorXd> force_map;
+MPC::StageTemplate &
+MPC::getStageTemplate(const std::map<std::string, bool> &contacts,
+                      const std::map<std::string, bool> &lands) {
+  StageTemplate &stage = stage_pool_[StagePattern(contacts, lands)];
+  if (stage.model != nullptr)
+    return stage;
 
+  // Stages are copied into the problem when the horizon recedes so the
+  // templates are never modified per node
+  Eigen::VectorXd force_ref(
+      problem_->getReferenceForce(0, problem_->getHandler().getFootName(0)));
+  int active_contacts = 0;
+  for (auto const &contact : contacts) {
+    if (contact.second)
+      active_contacts += 1;
+  }
+  force_ref.setZero();
+  Eigen::VectorXd force_zero = force_ref;
+  force_ref[2] = settings_.support_force / active_contacts;
+
+  std::map<std::string, pinocchio::SE3> contact_poses;
+  std::map<std::string, Eigen::VectorXd> force_map;
+  for (auto const &name : ee_names_) {
+    contact_poses.insert({name, problem_->getHandler().getFootPose(name)});
+    if (contacts.at(name))
+      force_map.insert({name, force_ref});
+    else
+      force_map.insert({name, force_zero});
+  }
+  stage.model = std::make_shared<StageModel>(
+      problem_->createStage(contacts, contact_poses, force_map, lands));
+  return stage;
+}
+
+MPC::StageTemplate &MPC::getBlockedTemplate(const StagePattern &pattern) {
+  StageTemplate &stage = getStageTemplate(pattern.first, pattern.second);
+  if (stage.blocked == nullptr) {
+    stage.blocked = std::make_shared<StageTemplate>();
+    stage.blocked->model = std::make_shared<StageModel>(*stage.model);
+    problem_->scaleStage(*stage.blocked->model,
+                         (double)settings_.blocking_factor);
+  }
+  return *stage.blocked;
+}
+
+void MPC::clearTemplateData(std::map<StagePattern, StageTemplate> &pool) {
+  for (auto &entry : pool) {
+    entry.second.data.clear();
+    entry.second.next_data = 0;
+    if (entry.second.blocked) {
+      entry.second.blocked->data.clear();
+      entry.second.blocked->next_data = 0;
+    }
+  }
+}
+
+std::shared_ptr<StageData> MPC::nextTemplateData(StageTemplate &stage) {
+  // Nodes of a pattern take its data in turn, skipping the ones still held
+  // by the solver or a queued node. Data are only created until there are
+  // enough for the nodes of this pattern in the window.
+  for (std::size_t i = 0; i < stage.data.size(); i++) {
+    std::shared_ptr<StageData> data = stage.data[stage.next_data];
+    stage.next_data = (stage.next_data + 1) % stage.data.size();
+    if (data.use_count() == 2)
+      return data;
+  }
+  stage.data.push_back(stage.model->createData());
+  stage.next_data = 0;
+  return stage.data.back();
+}
+
+void MPC::appendContactPlan(
+    const std::vector<std::map<std::string, bool>> &contact_states) {
+  for (auto const &state : contact_states) {
     for (auto const &name : ee_names_) {
-      contact_poses.insert({name, problem_->getHandler().getFootPose(name)});
-      if (state.at(name))
-        force_map.insert({name, force_ref});
-      else
-        force_map.insert({name, force_zero});
+      if (state.find(name) == state.end())
+        throw std::runtime_error("Contact plan node misses foot " + name);
     }
+  }
+  if (contact_plan_.empty())
+    dropFutureEvents();
+
+  for (auto const &state : contact_states) {
+    const std::map<std::string, bool> &previous =
+        contact_plan_.empty() ? tail_contacts_ : contact_plan_.back().contacts;
+    // The k-th queued node enters the horizon k + 1 recedes from now
+    const int time = (int)(contact_plan_.size() + getHorizonNodes());
     std::map<std::string, bool> land_contacts;
     for (auto const &name : ee_names_) {
-      if (!previous_contacts.at(name) and state.at(name)) {
-        land_contacts.insert({name, true});
-      } else {
-        land_contacts.insert({name, false});
+      land_contacts.insert({name, !previous.at(name) and state.at(name)});
+      if (previous.at(name) and !state.at(name))
+        foot_takeoff_times_.at(name).push_back(time);
+      if (!previous.at(name) and state.at(name))
+        foot_land_times_.at(name).push_back(time);
+    }
+
+    StageTemplate &stage = getStageTemplate(state, land_contacts);
+    PlanNode node;
+    node.contacts = state;
+    node.stage = stage.model;
+    node.data = nextTemplateData(stage);
+    contact_plan_.push_back(node);
+  }
+}
+
+void MPC::appendContactPlan(const Eigen::Ref<const ContactSchedule> &schedule) {
+  if (schedule.cols() != (long)ee_names_.size()) {
+    throw std::runtime_error("Contact schedule must have one column per foot");
+  }
+  std::vector<std::map<std::string, bool>> contact_states(
+      (std::size_t)schedule.rows());
+  for (long i = 0; i < schedule.rows(); i++) {
+    for (std::size_t j = 0; j < ee_names_.size(); j++)
+      contact_states[(std::size_t)i].insert(
+          {ee_names_[j], schedule(i, (long)j)});
+  }
+  appendContactPlan(contact_states);
+}
+
+void MPC::appendFootsteps(const std::vector<std::string> &ee_names,
+                          const std::size_t swing_nodes,
+                          const std::size_t support_nodes) {
+  std::map<std::string, bool> support;
+  for (auto const &name : ee_names_) {
+    support.insert({name, true});
+  }
+  std::map<std::string, bool> swing = support;
+  for (auto const &name : ee_names) {
+    if (swing.find(name) == swing.end())
+      throw std::runtime_error("Unknown foot " + name);
+    swing.at(name) = false;
+  }
+  std::vector<std::map<std::string, bool>> contact_states(swing_nodes, swing);
+  contact_states.insert(contact_states.end(), support_nodes, support);
+  appendContactPlan(contact_states);
+}
+
+void MPC::clearContactPlan() {
+  if (contact_plan_.empty())
+    return;
+  contact_plan_.clear();
+  dropFutureEvents();
+  addResumeEvents();
+}
+
+void MPC::dropFutureEvents() {
+  int window = (int)getHorizonNodes();
+  for (auto const &name : ee_names_) {
+    std::vector<int> &takeoffs = foot_takeoff_times_[name];
+    std::vector<int> &lands = foot_land_times_[name];
+    takeoffs.erase(std::remove_if(takeoffs.begin(), takeoffs.end(),
+                                  [&](int t) { return t >= window; }),
+                   takeoffs.end());
+    lands.erase(std::remove_if(lands.begin(), lands.end(),
+                               [&](int t) { return t >= window; }),
+                lands.end());
+  }
+}
+
+void MPC::addResumeEvents() {
+  if (!cycleNext())
+    return;
+  // Ring entry i enters the horizon i + 1 recedes from now, the first one
+  // after the horizon tail
+  for (auto const &name : ee_names_) {
+    for (std::size_t i = 0; i < contact_states_.size(); i++) {
+      bool previous =
+          i == 0 ? tail_contacts_.at(name) : contact_states_[i - 1].at(name);
+      int time = (int)(i + getHorizonNodes());
+      if (previous and !contact_states_[i].at(name))
+        foot_takeoff_times_.at(name).push_back(time);
+      if (!previous and contact_states_[i].at(name))
+        foot_land_times_.at(name).push_back(time);
+    }
+  }
+}
+
+bool MPC::cycleNext() {
+  if (cycle_horizon_.empty())
+    return false;
+  if (now_ == WALKING)
+    return true;
+  // When standing, the cycle runs on until the last node has every foot down
+  for (auto const &contact : tail_contacts_) {
+    if (!contact.second)
+      return true;
+  }
+  return false;
+}
+
+void MPC::addCycleEvents() {
+  const std::size_t nodes = getHorizonNodes();
+  for (auto const &name : ee_names_) {
+    for (size_t i = 1; i < contact_states_.size(); i++) {
+      if (!contact_states_[i].at(name) and contact_states_[i - 1].at(name)) {
+        foot_takeoff_times_.at(name).push_back((int)(i + nodes));
+      }
+      if (contact_states_[i].at(name) and !contact_states_[i - 1].at(name)) {
+        foot_land_times_.at(name).push_back((int)(i + nodes));
       }
     }
+    if (contact_states_.back().at(name) and !contact_states_[0].at(name))
+      foot_takeoff_times_.at(name).push_back(
+          (int)(contact_states_.size() - 1 + nodes));
+    if (!contact_states_.back().at(name) and contact_states_[0].at(name))
+      foot_land_times_.at(name).push_back(
+          (int)(contact_states_.size() - 1 + nodes));
+  }
+}
 
-    std::shared_ptr<StageModel> sm = std::make_shared<StageModel>(
-        problem_->createStage(state, contact_poses, force_map, land_contacts));
-    cycle_horizon_.push_back(sm);
-    cycle_horizon_data_.push_back(sm->createData());
-    previous_contacts = state;
+void MPC::generateCycleHorizon(
+    const Eigen::Ref<const ContactSchedule> &schedule) {
+  if (schedule.cols() != (long)ee_names_.size()) {
+    throw std::runtime_error("Contact schedule must have one column per foot");
   }
+  std::vector<std::map<std::string, bool>> contact_states(
+      (std::size_t)schedule.rows());
+  for (long i = 0; i < schedule.rows(); i++) {
+    for (std::size_t j = 0; j < ee_names_.size(); j++)
+      contact_states[(std::size_t)i].insert(
+          {ee_names_[j], schedule(i, (long)j)});
+  }
+  generateCycleHorizon(contact_states);
 }
 
 void MPC::iterate(const Eigen::VectorXd &q_current,
                   const Eigen::VectorXd &v_current) {
+  clock_started_ = false;
+  node_phase_ = 0;
+  iterateNodes(q_current, v_current, 1);
+}
 
-  problem_->getHandler().updateState(q_current, v_current, false);
+void MPC::iterate(const Eigen::VectorXd &q_current,
+                  const Eigen::VectorXd &v_current, const double t_now) {
+  if (!clock_started_) {
+    clock_started_ = true;
+    clock_time_ = t_now;
+  }
+  if (t_now < clock_time_) {
+    throw std::runtime_error("MPC clock cannot go backwards");
+  }
+  // Elapsed time in nodes, the tolerance absorbs the rounding of periodic
+  // calls at exactly dt
+  const double nodes_elapsed =
+      node_phase_ + (t_now - clock_time_) / settings_.dt;
+  const double nodes = std::floor(nodes_elapsed + 1e-9);
+  node_phase_ = std::max(0., nodes_elapsed - nodes);
+  clock_time_ = t_now;
+  iterateNodes(q_current, v_current, (std::size_t)nodes);
+}
+
+void MPC::iterateNodes(const Eigen::VectorXd &q_current,
+                       const Eigen::VectorXd &v_current,
+                       const std::size_t nodes) {
+  // The whole tick is counted, allocations are only reported once real time
+  AllocationGuard guard(realtime_);
+
+  RobotHandler &handler = problem_->getHandler();
+  if (q_current.size() == handler.getModel().nq) {
+    handler.updateState(q_current, v_current, false);
+  } else {
+    const Eigen::VectorXd x = handler.shapeState(q_current, v_current);
+    handler.updateState(x.head(handler.getModel().nq),
+                        x.tail(handler.getModel().nv), false);
+  }
 
   // ~~TIMING~~ //
   std::chrono::steady_clock::time_point begin =
       std::chrono::steady_clock::now();
-  recedeWithCycle();
+  // Shaping the state of a reduced model and stage recycling, which copies
+  // stage models inside aligator, are known to allocate. They are counted
+  // apart from the rest of the tick.
+  for (std::size_t i = 0; i < nodes; i++)
+    recedeWithCycle();
+  tick_recede_allocations_ = guard.getAllocations();
   std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-  std::cout << "recedeCycle = "
-            << std::chrono::duration_cast<std::chrono::milliseconds>(end -
-                                                                     begin)
-                   .count()
-            << "[ms]" << std::endl;
+  if (settings_.verbose and !realtime_) {
+    std::cout << "recedeCycle = "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end -
+                                                                       begin)
+                     .count()
+              << "[ms]" << std::endl;
+  }
+  x0_ << problem_->getProblemState();
 
   // ~~REFERENCES~~ //
   updateStepTrackerReferences();
 
-  x0_ << problem_->getProblemState();
-  xs_.erase(xs_.begin());
-  xs_[0] = x0_;
-  xs_.push_back(xs_.back());
+  iterations_++;
+  // The prediction checked by canSkipSolve is the one of a single node
+  solve_skipped_ = nodes == 1 and canSkipSolve();
+
+  // Shift the warm start by rotating the buffers rather than erasing and
+  // appending, which would allocate a new vector
+  const std::size_t shift = std::min(nodes, us_.size() - 1);
+  std::size_t first_new = us_.size() - shift;
+  if (settings_.blocking_factor > 1) {
+    shiftBlockedWarmStart(shift);
+    first_new = 0;
+  } else {
+    std::rotate(xs_.begin(), xs_.begin() + (long)shift, xs_.end());
+    for (std::size_t i = xs_.size() - shift; i < xs_.size(); i++)
+      xs_[i] = xs_[xs_.size() - shift - 1];
 
-  us_.erase(us_.begin());
-  us_.push_back(us_.back());
+    std::rotate(us_.begin(), us_.begin() + (long)shift, us_.end());
+    for (std::size_t i = us_.size() - shift; i < us_.size(); i++)
+      us_[i] = us_[us_.size() - shift - 1];
+  }
+  xs_[0] = x0_;
+  // Stages with another control size, when stages only carry the forces of
+  // their active contacts, start from their reference
+  for (std::size_t i = first_new; i < us_.size(); i++) {
+    if (us_[i].size() != problem_->getProblem()->stages_[i]->nu())
+      us_[i] = problem_->getReferenceControl(i);
+  }
+  // The first stage is the second one of the last plan, with its feedback
+  // when that plan was accepted on the previous tick. Otherwise there is no
+  // feedback until the next accepted solve. Without a shift the first stage
+  // and its feedback are kept.
+  const long nu0 = (long)problem_->getProblem()->stages_[0]->nu();
+  if (shift > 0) {
+    if (K1_valid_ and getStageNode(1) == shift and K1_.rows() == nu0)
+      K0_.swap(K1_);
+    else
+      K0_.setZero(nu0, K0_.cols());
+    K1_valid_ = false;
+  }
 
   problem_->getProblem()->setInitState(x0_);
 
+  if (settings_.predict_command and !solve_skipped_ and
+      velocity_base_ != solved_velocity_base_)
+    predictCommandChange(shift);
+
+  // The shifted plan and its feedback are kept, as on a rejection
+  if (solve_skipped_) {
+    consecutive_skips_++;
+    skipped_solves_++;
+    saved_solve_time_ += last_solve_time_;
+    countTickAllocations(guard);
+    return;
+  }
+
   // ~~SOLVER~~ //
   std::chrono::steady_clock::time_point begin5 =
       std::chrono::steady_clock::now();
   solver_->run(*problem_->getProblem(), xs_, us_);
   std::chrono::steady_clock::time_point end5 = std::chrono::steady_clock::now();
-  std::cout << "solve = "
-            << std::chrono::duration_cast<std::chrono::milliseconds>(end5 -
-                                                                     begin5)
-                   .count()
-            << "[ms]" << std::endl;
+  last_solve_time_ = std::chrono::duration<double>(end5 - begin5).count();
+  consecutive_skips_ = 0;
+  solved_velocity_base_ = velocity_base_;
+  if (settings_.verbose and !realtime_) {
+    std::cout << "solve = "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end5 -
+                                                                       begin5)
+                     .count()
+              << "[ms]" << std::endl;
+  }
+
+  // On rejection xs_, us_ and K0_ keep the shifted previous plan, xs_ and
+  // us_ being also the next warm start. The multipliers of the rejected run
+  // are dropped rather than warm-started from.
+  solution_status_ = acceptSolution();
+  if (solution_status_ != SOLUTION_OK) {
+    rejected_solutions_++;
+    solver_->resetMultipliers();
+  }
+  countTickAllocations(guard);
+}
+
+void MPC::countTickAllocations(const AllocationGuard &guard) {
+  tick_allocations_ = guard.getAllocations();
+  if (realtime_)
+    hot_path_allocations_ += tick_allocations_;
+}
 
-  xs_ = solver_->results_.xs;
-  us_ = solver_->results_.us;
-  K0_ = solver_->results_.getCtrlFeedbacks()[0];
+bool MPC::canSkipSolve() {
+  if (settings_.skip_state_tol <= 0 or
+      consecutive_skips_ >= settings_.max_skipped_solves or
+      solution_status_ != SOLUTION_OK)
+    return false;
+  if ((velocity_base_ - solved_velocity_base_).norm() >=
+      settings_.skip_reference_tol)
+    return false;
+
+  // xs_[1] is the prediction of the last plan for the current tick
+  problem_->getProblem()->stages_[0]->xspace_->difference(xs_[1], x0_,
+                                                          state_deviation_);
+  return state_deviation_.norm() < settings_.skip_state_tol;
+}
+
+void MPC::predictCommandChange(const std::size_t shift) {
+  // The solver gains are only the ones of the plan after an accepted solve
+  const Model &model = problem_->getHandler().getModel();
+  if (solution_status_ != SOLUTION_OK or xs_[0].size() != model.nq + model.nv)
+    return;
+  const std::vector<Eigen::MatrixXd> &gains = solver_->getResults().gains_;
+  const long ndx = 2 * model.nv;
+  // Buffers only reallocate after a change of model
+  predictor_dx_.setZero(ndx);
+  predictor_q_.resize(model.nq);
+
+  const double nodes = (double)getHorizonNodes();
+  // Base displacement accumulated over the previous nodes and velocity
+  // change, in the world frame of the command
+  Eigen::Matrix<double, 6, 1> displacement;
+  Eigen::Matrix<double, 6, 1> velocity;
+  displacement.setZero();
+  velocity.setZero();
+  for (std::size_t t = 1; t < xs_.size(); t++) {
+    const double dt =
+        settings_.dt * (double)(getStageNode(t) - getStageNode(t - 1));
+    displacement += dt * velocity;
+    velocity = ((double)getStageNode(t) / nodes) *
+               (velocity_base_ - solved_velocity_base_);
+
+    // The free-flyer tangent is in the frame of the stage base
+    const Eigen::Quaterniond quat(xs_[t].segment<4>(3));
+    const Eigen::Matrix3d R_t =
+        quat.normalized().toRotationMatrix().transpose();
+    for (long k = 0; k < 6; k += 3) {
+      predictor_dx_.segment<3>(k) = R_t * displacement.segment<3>(k);
+      predictor_dx_.segment<3>(model.nv + k) = R_t * velocity.segment<3>(k);
+    }
+
+    pinocchio::integrate(model, xs_[t].head(model.nq),
+                         predictor_dx_.head(model.nv), predictor_q_);
+    xs_[t].head(model.nq) = predictor_q_;
+    xs_[t].segment(model.nq, 6) += predictor_dx_.segment(model.nv, 6);
+
+    // Stage t starts in the stage of the last solve covering its node
+    // shifted. Its gains hold the feedforward in the first column and the
+    // feedback in the next ones.
+    if (t >= us_.size() or gains.empty())
+      continue;
+    const Eigen::MatrixXd &gain = gains[std::min(
+        getNodeStage(getStageNode(t) + shift), gains.size() - 1)];
+    const long nu = us_[t].size();
+    if (gain.cols() == ndx + 1 and gain.rows() >= nu)
+      us_[t].noalias() += gain.block(0, 1, nu, ndx) * predictor_dx_;
+  }
+}
+
+void MPC::prepareRealTime(const Eigen::VectorXd &q_current,
+                          const Eigen::VectorXd &v_current) {
+  // Gait events are appended and erased once per cycle, keep room for all
+  // the ones that can be in the window at once
+  for (auto const &name : ee_names_) {
+    foot_takeoff_times_[name].reserve(contact_states_.size() + max_horizon_);
+    foot_land_times_[name].reserve(contact_states_.size() + max_horizon_);
+  }
+  realtime_ = false;
+  iterate(q_current, v_current);
+  lockMemory();
+  realtime_ = true;
+}
+
+MPC::SolutionStatus MPC::acceptSolution() {
+  const std::vector<Eigen::VectorXd> &xs = solver_->getResults().xs;
+  const std::vector<Eigen::VectorXd> &us = solver_->getResults().us;
+  const double cost = solver_->getResults().traj_cost_;
+
+  if (!std::isfinite(cost))
+    return SOLUTION_NOT_FINITE;
+  // A jump is only rejected once: the next cost is compared to this one, so
+  // that a lasting change of references does not lock the plan
+  const double previous_cost = last_cost_;
+  last_cost_ = cost;
+  if (cost > settings_.max_cost_ratio * std::max(previous_cost, 1e-12))
+    return SOLUTION_COST_JUMP;
+  if (solver_->getResults().prim_infeas > settings_.max_prim_infeas)
+    return SOLUTION_INFEASIBLE;
+
+  // Same-size assignments, no reallocation except after a horizon change
+  xs_candidate_.resize(xs.size());
+  us_candidate_.resize(us.size());
+  bool finite = true;
+  for (std::size_t i = 0; i < xs.size(); i++) {
+    xs_candidate_[i] = xs[i];
+    finite = finite and xs_candidate_[i].allFinite();
+  }
+  for (std::size_t i = 0; i < us.size(); i++) {
+    us_candidate_[i] = us[i];
+    finite = finite and us_candidate_[i].allFinite();
+  }
+  // Read from the gains in place, getCtrlFeedbacks would copy all of them
+  getFeedback(0, K0_candidate_);
+  getFeedback(1, K1_candidate_);
+  finite = finite and K0_candidate_.allFinite() and
+           K1_candidate_.allFinite();
+  if (!finite)
+    return SOLUTION_NOT_FINITE;
+
+  xs_.swap(xs_candidate_);
+  us_.swap(us_candidate_);
+  K0_.swap(K0_candidate_);
+  K1_.swap(K1_candidate_);
+  K1_valid_ = true;
+
+  return SOLUTION_OK;
+}
+
+void MPC::getFeedback(const std::size_t t, Eigen::MatrixXd &K) {
+  // The gains hold the feedforward in their first column
+  const ResultsBase &results = solver_->getResults();
+  const std::size_t i = std::min(t, results.us.size() - 1);
+  const Eigen::MatrixXd &gain = results.gains_[i];
+  K = gain.block(0, 1, results.us[i].size(), gain.cols() - 1);
+}
+
+Eigen::VectorXd MPC::getFullControl(const std::size_t t) {
+  return problem_->getFullControl(t, us_[t]);
+}
+
+Eigen::MatrixXd MPC::getFullFeedback() {
+  Eigen::MatrixXd K(problem_->getNu(), K0_.cols());
+  for (long j = 0; j < K0_.cols(); j++)
+    K.col(j) = problem_->getFullControl(0, K0_.col(j));
+  return K;
 }
 
 void MPC::recedeWithCycle() {
-  if (now_ == WALKING or
-      problem_->getContactSupport(settings_.T - 1) < ee_names_.size()) {
+  // With move blocking the stage appended to the problem is not the node
+  // entering the horizon, see recedeBlockedStages
+  const bool blocking = settings_.blocking_factor > 1;
+  if (!contact_plan_.empty()) {
+    PlanNode &node = contact_plan_.front();
+    if (!blocking) {
+      problem_->getProblem()->replaceStageCircular(*node.stage);
+      solver_->cycleProblem(*problem_->getProblem(), node.data);
+    }
 
-    problem_->getProblem()->replaceStageCircular(*cycle_horizon_[0]);
-    solver_->cycleProblem(*problem_->getProblem(), cycle_horizon_data_[0]);
+    // Same keys, the map nodes are reused
+    tail_contacts_ = node.contacts;
+    contact_plan_.pop_front();
+    updateCycleTiming(false);
+    if (contact_plan_.empty())
+      addResumeEvents();
+  } else if (cycleNext()) {
+    if (!blocking) {
+      problem_->getProblem()->replaceStageCircular(*cycle_horizon_[0]);
+      solver_->cycleProblem(*problem_->getProblem(), cycle_horizon_data_[0]);
+    }
 
     rotate_vec_left(cycle_horizon_);
     rotate_vec_left(cycle_horizon_data_);
     rotate_vec_left(contact_states_);
+    cycle_offset_ = (cycle_offset_ + 1) % cycle_horizon_.size();
+    tail_contacts_ = contact_states_.back();
+    const int lookahead = (int)(contact_states_.size() - 1 + getHorizonNodes());
     for (auto const &name : ee_names_) {
       if (!contact_states_[contact_states_.size() - 1].at(name) and
           contact_states_[contact_states_.size() - 2].at(name))
-        foot_takeoff_times_.at(name).push_back(
-            (int)(contact_states_.size() - 1 + problem_->getSize()));
+        foot_takeoff_times_.at(name).push_back(lookahead);
       if (contact_states_[contact_states_.size() - 1].at(name) and
           !contact_states_[contact_states_.size() - 2].at(name))
-        foot_land_times_.at(name).push_back(
-            (int)(contact_states_.size() - 1 + problem_->getSize()));
+        foot_land_times_.at(name).push_back(lookahead);
     }
     updateCycleTiming(false);
   } else {
-    problem_->getProblem()->replaceStageCircular(*standing_horizon_[0]);
-    solver_->cycleProblem(*problem_->getProblem(), standing_horizon_data_[0]);
+    if (!blocking) {
+      problem_->getProblem()->replaceStageCircular(*standing_horizon_[0]);
+      solver_->cycleProblem(*problem_->getProblem(),
+                            standing_horizon_data_[0]);
+    }
 
     rotate_vec_left(standing_horizon_);
     rotate_vec_left(standing_horizon_data_);
+    for (auto &contact : tail_contacts_)
+      contact.second = true;
 
     updateCycleTiming(true);
   }
+  rotate_vec_left(horizon_contacts_);
+  horizon_contacts_.back() = tail_contacts_;
+  if (blocking)
+    recedeBlockedStages();
+}
+
+std::size_t MPC::getStageNode(const std::size_t t) {
+  const std::size_t start = settings_.blocking_start;
+  if (settings_.blocking_factor <= 1 or t <= start)
+    return t;
+  return start + settings_.blocking_factor * (t - start);
+}
+
+std::size_t MPC::getNodeStage(const std::size_t node) {
+  const std::size_t start = settings_.blocking_start;
+  if (settings_.blocking_factor <= 1 or node <= start)
+    return node;
+  return start + (node - start) / settings_.blocking_factor;
+}
+
+MPC::StagePattern MPC::getStagePattern(const std::size_t t) {
+  // Landings are the contacts gained since the node of the previous stage
+  StagePattern pattern(horizon_contacts_[getStageNode(t)],
+                       std::map<std::string, bool>());
+  for (auto const &name : ee_names_) {
+    const bool land =
+        t > 0 and pattern.first.at(name) and
+        !horizon_contacts_[getStageNode(t - 1)].at(name);
+    pattern.second.insert({name, land});
+  }
+  return pattern;
+}
+
+void MPC::recedeBlockedStages() {
+  TrajOptProblem &problem = *problem_->getProblem();
+  const std::size_t size = problem_->getSize();
+  const std::size_t start = settings_.blocking_start;
+
+  // Stages move one index down as without blocking. The appended one is the
+  // node a factor before the horizon tail.
+  StagePattern pattern = getStagePattern(size - 1);
+  StageTemplate &tail = start < size
+                            ? getBlockedTemplate(pattern)
+                            : getStageTemplate(pattern.first, pattern.second);
+  problem.replaceStageCircular(*tail.model);
+  solver_->cycleProblem(problem, nextTemplateData(tail));
+  rotate_vec_left(stage_patterns_);
+  stage_patterns_.back() = pattern;
+  if (start >= size)
+    return;
+
+  // The stage leaving the blocked region keeps its pattern, hence its data,
+  // and covers one node again: it is copied unscaled from its template
+  if (start > 0) {
+    const StagePattern &boundary = stage_patterns_[start - 1];
+    problem.stages_[start - 1] =
+        *getStageTemplate(boundary.first, boundary.second).model;
+  }
+
+  // Blocked stages now start one node later than the stages they were
+  // shifted from. The ones whose pattern changed are copied again with data
+  // of their new pattern, in place as long as their dimensions and those of
+  // their constraints are kept.
+  bool resized = false;
+  for (std::size_t t = start; t + 1 < size; t++) {
+    pattern = getStagePattern(t);
+    if (pattern == stage_patterns_[t])
+      continue;
+    StageTemplate &blocked = getBlockedTemplate(pattern);
+    const StageModel &previous = *problem.stages_[t];
+    const bool same_dims =
+        previous.nu() == blocked.model->nu() and
+        previous.nc() == blocked.model->nc() and
+        previous.constraints_.dims() == blocked.model->constraints_.dims();
+    problem.stages_[t] = *blocked.model;
+    stage_patterns_[t] = pattern;
+    if (same_dims and !resized)
+      resized = !solver_->setStageData(t, nextTemplateData(blocked),
+                                       nextTemplateData(blocked));
+    else
+      resized = true;
+  }
+  if (resized)
+    solver_->setup(problem);
+}
+
+void MPC::rebuildStages() {
+  TrajOptProblem &problem = *problem_->getProblem();
+  const std::size_t size = problem_->getSize();
+  stage_patterns_.resize(size);
+  for (std::size_t t = 0; t < size; t++) {
+    stage_patterns_[t] = getStagePattern(t);
+    if (settings_.blocking_factor > 1 and t >= settings_.blocking_start)
+      problem.stages_[t] = *getBlockedTemplate(stage_patterns_[t]).model;
+    else
+      problem.stages_[t] = *getStageTemplate(stage_patterns_[t].first,
+                                             stage_patterns_[t].second)
+                                .model;
+  }
+}
+
+void MPC::shiftBlockedWarmStart(const std::size_t nodes) {
+  // Stage t now starts nodes later, between the starts of the stages j and
+  // j + 1 of the previous plan, whose control is held over that interval.
+  // Going through increasing t only reads the previous plan since j >= t.
+  const std::size_t size = us_.size();
+  const auto &space = problem_->getProblem()->stages_[0]->xspace_;
+  blocking_x_.resize(xs_[0].size());
+  for (std::size_t t = 0; t <= size; t++) {
+    const std::size_t node = getStageNode(t) + nodes;
+    const std::size_t j = getNodeStage(node);
+    if (j >= size) {
+      xs_[t] = xs_[size];
+      if (t < size)
+        us_[t] = us_[size - 1];
+      continue;
+    }
+    const double s = (double)(node - getStageNode(j)) /
+                     (double)(getStageNode(j + 1) - getStageNode(j));
+    if (s > 0) {
+      space->interpolate(xs_[j], xs_[j + 1], s, blocking_x_);
+      xs_[t] = blocking_x_;
+    } else {
+      xs_[t] = xs_[j];
+    }
+    if (t < size)
+      us_[t] = us_[j];
+  }
 }
 
 void MPC::updateCycleTiming(const bool updateOnlyHorizon) {
   for (auto const &name : ee_names_) {
     for (size_t i = 0; i < foot_land_times_.at(name).size(); i++) {
       if (!updateOnlyHorizon or
-          foot_land_times_.at(name)[i] < (int)problem_->getSize())
+          foot_land_times_.at(name)[i] < (int)getHorizonNodes())
         foot_land_times_.at(name)[i] -= 1;
     }
     if (!foot_land_times_.at(name).empty() and foot_land_times_.at(name)[0] < 0)
@@ -260,7 +991,7 @@ void MPC::updateCycleTiming(const bool updateOnlyHorizon) {
 
     for (size_t i = 0; i < foot_takeoff_times_.at(name).size(); i++)
       if (!updateOnlyHorizon or
-          foot_takeoff_times_.at(name)[i] < (int)problem_->getSize()) {
+          foot_takeoff_times_.at(name)[i] < (int)getHorizonNodes()) {
         foot_takeoff_times_.at(name)[i] -= 1;
       }
     if (!foot_takeoff_times_.at(name).empty() and
@@ -269,6 +1000,122 @@ void MPC::updateCycleTiming(const bool updateOnlyHorizon) {
   }
 }
 
+void MPC::setHorizonLength(const std::size_t T) {
+  if (T == 0 or T > max_horizon_) {
+    throw std::runtime_error("Horizon length must be between 1 and " +
+                             std::to_string(max_horizon_));
+  }
+  if (!contact_plan_.empty()) {
+    throw std::runtime_error(
+        "Horizon length cannot change while a contact plan is queued");
+  }
+  std::size_t size = problem_->getSize();
+  if (T == size)
+    return;
+
+  // The gait bookkeeping is per node, without move blocking a node is also
+  // the stage appended or removed
+  const bool blocking = settings_.blocking_factor > 1;
+  const std::size_t nodes = getStageNode(size);
+  const std::size_t new_nodes = getStageNode(T);
+  bool walking = cycleNext();
+  if (T < size) {
+    // Removed tail nodes are the last ones taken out of the ring, so giving
+    // them back amounts to rotating the ring the other way
+    problem_->getProblem()->stages_.resize(T);
+    if (walking) {
+      for (std::size_t i = 0; i < nodes - new_nodes; i++) {
+        std::rotate(cycle_horizon_.rbegin(), cycle_horizon_.rbegin() + 1,
+                    cycle_horizon_.rend());
+        std::rotate(cycle_horizon_data_.rbegin(),
+                    cycle_horizon_data_.rbegin() + 1,
+                    cycle_horizon_data_.rend());
+        std::rotate(contact_states_.rbegin(), contact_states_.rbegin() + 1,
+                    contact_states_.rend());
+        cycle_offset_ =
+            (cycle_offset_ + cycle_horizon_.size() - 1) % cycle_horizon_.size();
+      }
+      // Events beyond the new lookahead are pushed again by recedeWithCycle
+      // once the ring reaches them
+      int lookahead = (int)(contact_states_.size() - 1 + new_nodes);
+      for (auto const &name : ee_names_) {
+        std::vector<int> &takeoffs = foot_takeoff_times_.at(name);
+        std::vector<int> &lands = foot_land_times_.at(name);
+        takeoffs.erase(std::remove_if(takeoffs.begin(), takeoffs.end(),
+                                      [&](int t) { return t >= lookahead; }),
+                       takeoffs.end());
+        lands.erase(std::remove_if(lands.begin(), lands.end(),
+                                   [&](int t) { return t >= lookahead; }),
+                    lands.end());
+      }
+      tail_contacts_ = contact_states_.back();
+    } else if (!blocking) {
+      for (std::size_t i = 0; i < size - T; i++) {
+        std::rotate(standing_horizon_.rbegin(), standing_horizon_.rbegin() + 1,
+                    standing_horizon_.rend());
+        std::rotate(standing_horizon_data_.rbegin(),
+                    standing_horizon_data_.rbegin() + 1,
+                    standing_horizon_data_.rend());
+      }
+    }
+    horizon_contacts_.resize(new_nodes);
+    stage_patterns_.resize(T);
+    xs_.resize(T + 1);
+    us_.resize(T);
+  } else {
+    for (std::size_t i = nodes; i < new_nodes; i++) {
+      if (walking) {
+        if (!blocking)
+          problem_->getProblem()->addStage(*cycle_horizon_[0]);
+        rotate_vec_left(cycle_horizon_);
+        rotate_vec_left(cycle_horizon_data_);
+        rotate_vec_left(contact_states_);
+        cycle_offset_ = (cycle_offset_ + 1) % cycle_horizon_.size();
+        // Same bookkeeping as recedeWithCycle, without the shift of the
+        // window start
+        for (auto const &name : ee_names_) {
+          if (!contact_states_[contact_states_.size() - 1].at(name) and
+              contact_states_[contact_states_.size() - 2].at(name))
+            foot_takeoff_times_.at(name).push_back(
+                (int)(contact_states_.size() - 1 + i));
+          if (contact_states_[contact_states_.size() - 1].at(name) and
+              !contact_states_[contact_states_.size() - 2].at(name))
+            foot_land_times_.at(name).push_back(
+                (int)(contact_states_.size() - 1 + i));
+        }
+        tail_contacts_ = contact_states_.back();
+      } else {
+        if (!blocking) {
+          problem_->getProblem()->addStage(*standing_horizon_[0]);
+          rotate_vec_left(standing_horizon_);
+          rotate_vec_left(standing_horizon_data_);
+        }
+        for (auto &contact : tail_contacts_)
+          contact.second = true;
+      }
+      horizon_contacts_.push_back(tail_contacts_);
+    }
+    for (std::size_t i = size; i < T; i++) {
+      // Copied again from the templates of their nodes below
+      if (blocking)
+        problem_->getProblem()->addStage(*problem_->getProblem()->stages_[0]);
+      xs_.push_back(xs_.back());
+      us_.push_back(us_.back());
+    }
+    if (blocking)
+      rebuildStages();
+    for (std::size_t i = size; i < T; i++) {
+      if (us_[i].size() != problem_->getProblem()->stages_[i]->nu())
+        us_[i] = problem_->getReferenceControl(i);
+    }
+  }
+
+  settings_.T = T;
+  foot_trajectories_.setHorizon(new_nodes);
+  // The solver workspace is sized on the number of stages
+  solver_->setup(*problem_->getProblem());
+}
+
 void MPC::updateStepTrackerReferences() {
   bool update = false;
   for (auto const &name : ee_names_) {
@@ -304,9 +1151,16 @@ void MPC::updateStepTrackerReferences() {
                               settings_.dt, */
         problem_->getHandler().getFootPose(name).translation(),
         ref_pose.translation(), name);
+    // References are sampled node_phase_ nodes ahead of the stage times,
+    // at the node each stage starts
+    const std::vector<point3_t> &reference =
+        foot_trajectories_.getReference(name);
     pinocchio::SE3 pose = pinocchio::SE3::Identity();
     for (unsigned long time = 0; time < problem_->getSize(); time++) {
-      pose.translation() = foot_trajectories_.getReference(name)[time];
+      const std::size_t node = getStageNode(time);
+      const std::size_t next = std::min(node + 1, reference.size() - 1);
+      pose.translation() = (1 - node_phase_) * reference[node] +
+                           node_phase_ * reference[next];
       setReferencePose(time, name, pose);
     }
   }
@@ -339,6 +1193,237 @@ const pinocchio::SE3 MPC::getReferencePose(const std::size_t t,
   return problem_->getReferencePose(t, ee_name);
 }
 
+void MPC::setCostWeights(const std::string &cost_name,
+                         const Eigen::MatrixXd &weights) {
+  // Some components only exist in some contact phases, e.g. pruned stance
+  // costs, so the name only has to match in one of the stages
+  const CostStack::CostKey key(cost_name);
+  // Every stage is checked first, a mismatch leaves all of them unchanged.
+  // Templates of the queued nodes and of the next plans are in the pool.
+  bool found = false;
+  for (auto &sm : problem_->getProblem()->stages_) {
+    found |= problem_->checkStageCostWeights(*sm, key, weights);
+  }
+  for (auto &sm : cycle_horizon_) {
+    found |= problem_->checkStageCostWeights(*sm, key, weights);
+  }
+  for (auto &sm : standing_horizon_) {
+    found |= problem_->checkStageCostWeights(*sm, key, weights);
+  }
+  for (auto &stage : stage_pool_) {
+    found |= problem_->checkStageCostWeights(*stage.second.model, key, weights);
+    if (stage.second.blocked)
+      problem_->checkStageCostWeights(*stage.second.blocked->model, key,
+                                      weights);
+  }
+  if (!found) {
+    throw std::runtime_error("No stage has a cost named " + cost_name);
+  }
+
+  for (auto &sm : problem_->getProblem()->stages_) {
+    problem_->setStageCostWeights(*sm, key, weights);
+  }
+  for (auto &sm : cycle_horizon_) {
+    problem_->setStageCostWeights(*sm, key, weights);
+  }
+  for (auto &sm : standing_horizon_) {
+    problem_->setStageCostWeights(*sm, key, weights);
+  }
+  // Blocked templates only scale the weight of the cost components
+  for (auto &stage : stage_pool_) {
+    problem_->setStageCostWeights(*stage.second.model, key, weights);
+    if (stage.second.blocked)
+      problem_->setStageCostWeights(*stage.second.blocked->model, key,
+                                    weights);
+  }
+}
+
+void MPC::setLinkInertia(const std::string &joint_name,
+                         const pinocchio::Inertia &inertia) {
+  problem_->getHandler().setLinkInertia(joint_name, inertia);
+  // A variant where the link is locked or merged keeps its inertias
+  for (auto &variant : model_variants_) {
+    RobotHandler &handler = variant.second.problem->getHandler();
+    if (handler.getModel().existJointName(joint_name))
+      handler.setLinkInertia(joint_name, inertia);
+  }
+  updateInertias();
+}
+
+void MPC::setMass(const double mass) {
+  problem_->getHandler().setMass(mass);
+  for (auto &variant : model_variants_)
+    variant.second.problem->getHandler().setMass(mass);
+  updateInertias();
+}
+
+void MPC::updateInertias() {
+  const double force_scale = problem_->getHandler().getMass() / mass_;
+  mass_ = problem_->getHandler().getMass();
+  settings_.support_force *= force_scale;
+
+  problem_->updateInertias(force_scale);
+  for (auto &sm : standing_horizon_) {
+    problem_->updateStageInertias(*sm, force_scale);
+  }
+  // The cycle horizon and the queued plan nodes share these templates
+  for (auto &stage : stage_pool_) {
+    problem_->updateStageInertias(*stage.second.model, force_scale);
+    if (stage.second.blocked)
+      problem_->updateStageInertias(*stage.second.blocked->model, force_scale);
+  }
+
+  // Data of the updated stages were created for their previous dynamics
+  for (std::size_t i = 0; i < standing_horizon_.size(); i++)
+    standing_horizon_data_[i] = standing_horizon_[i]->createData();
+  clearTemplateData(stage_pool_);
+  for (auto &node : contact_plan_)
+    node.data = node.stage->createData();
+  solver_->setup(*problem_->getProblem());
+
+  // Each variant scales its force references with its own mass
+  for (auto &variant : model_variants_) {
+    ModelVariant &v = variant.second;
+    const double variant_scale = v.problem->getHandler().getMass() / v.mass;
+    v.mass = v.problem->getHandler().getMass();
+    v.problem->updateInertias(variant_scale);
+    for (auto &sm : v.standing_horizon) {
+      v.problem->updateStageInertias(*sm, variant_scale);
+    }
+    for (auto &stage : v.stage_pool) {
+      v.problem->updateStageInertias(*stage.second.model, variant_scale);
+      if (stage.second.blocked)
+        v.problem->updateStageInertias(*stage.second.blocked->model,
+                                       variant_scale);
+    }
+    // Their solver is set up on a switch
+    for (std::size_t i = 0; i < v.standing_horizon.size(); i++)
+      v.standing_horizon_data[i] = v.standing_horizon[i]->createData();
+    clearTemplateData(v.stage_pool);
+  }
+}
+
+void MPC::addModelVariant(const std::string &name,
+                          std::shared_ptr<Problem> problem) {
+  if (name == active_variant_ or model_variants_.count(name) > 0) {
+    throw std::runtime_error("Model variant " + name + " already exists");
+  }
+  if (problem->getSize() != max_horizon_) {
+    throw std::runtime_error("Model variant must have " +
+                             std::to_string(max_horizon_) + " stages");
+  }
+  RobotHandler &handler = problem->getHandler();
+  if (handler.getFeetNames() != ee_names_) {
+    throw std::runtime_error("Model variant must have the same feet");
+  }
+  for (Problem *p : {problem_.get(), problem.get()}) {
+    const Model &model = p->getHandler().getModel();
+    if (p->getProblemState().size() != model.nq + model.nv) {
+      throw std::runtime_error("Model variants need a [q; v] state");
+    }
+  }
+
+  ModelVariant variant;
+  variant.problem = problem;
+  variant.solver = createSolver();
+  variant.solver->setMaxIters(settings_.max_iters);
+  variant.mass = handler.getMass();
+
+  // Same standing stages as initialize
+  Eigen::VectorXd force_ref(
+      problem->getReferenceForce(0, handler.getFootName(0)));
+  std::map<std::string, bool> contact_states;
+  std::map<std::string, bool> land_constraint;
+  std::map<std::string, pinocchio::SE3> contact_poses;
+  std::map<std::string, Eigen::VectorXd> force_map;
+  for (auto const &ee_name : ee_names_) {
+    contact_states.insert({ee_name, true});
+    land_constraint.insert({ee_name, false});
+    contact_poses.insert({ee_name, handler.getFootPose(ee_name)});
+    force_map.insert({ee_name, force_ref});
+  }
+  for (std::size_t i = 0; i < max_horizon_; i++) {
+    std::shared_ptr<StageModel> sm =
+        std::make_shared<StageModel>(problem->createStage(
+            contact_states, contact_poses, force_map, land_constraint));
+    variant.standing_horizon.push_back(sm);
+    variant.standing_horizon_data.push_back(sm->createData());
+  }
+  model_variants_.insert({name, variant});
+}
+
+void MPC::switchModelVariant(const std::string &name) {
+  if (name == active_variant_)
+    return;
+  auto variant = model_variants_.find(name);
+  if (variant == model_variants_.end()) {
+    throw std::runtime_error("Unknown model variant " + name);
+  }
+  if (!contact_plan_.empty()) {
+    throw std::runtime_error(
+        "Model variant cannot change while a contact plan is queued");
+  }
+  // support_force and the force references follow the mass of the active
+  // variant
+  const double mass = variant->second.problem->getHandler().getMass();
+  if (std::abs(mass - mass_) > 1e-6 * mass_) {
+    throw std::runtime_error("Model variant " + name +
+                             " does not have the mass of the active variant");
+  }
+
+  // The members of the active variant are stored back in its place
+  std::shared_ptr<Problem> previous = problem_;
+  ModelVariant &next = variant->second;
+  std::swap(problem_, next.problem);
+  std::swap(solver_, next.solver);
+  std::swap(standing_horizon_, next.standing_horizon);
+  std::swap(standing_horizon_data_, next.standing_horizon_data);
+  std::swap(stage_pool_, next.stage_pool);
+  std::swap(mass_, next.mass);
+  model_variants_.insert({active_variant_, std::move(next)});
+  model_variants_.erase(variant);
+  active_variant_ = name;
+
+  // Same contacts over the horizon, landings following from the contacts of
+  // consecutive stages
+  TrajOptProblem &problem = *problem_->getProblem();
+  const std::size_t size = previous->getSize();
+  problem.stages_.resize(size);
+  rebuildStages();
+  for (std::size_t t = 0; t < size; t++)
+    problem_->setVelocityBase(t, previous->getVelocityBase(t));
+  buildCycleHorizon();
+
+  // Warm start mapped joint by joint. The force variables are kept when
+  // both stages have the same, the other controls start from the reference.
+  const Model &source = previous->getHandler().getModel();
+  RobotHandler &handler = problem_->getHandler();
+  const long nq = handler.getModel().nq;
+  const long nv = handler.getModel().nv;
+  for (auto &x : xs_)
+    x = handler.mapState(source, x);
+  for (std::size_t t = 0; t < us_.size(); t++) {
+    Eigen::VectorXd u = problem_->getReferenceControl(t);
+    const long forces = u.size() - (nv - 6);
+    if (us_[t].size() - (source.nv - 6) == forces)
+      u.head(forces) = us_[t].head(forces);
+    handler.mapActuated(source, us_[t].tail(source.nv - 6), u.tail(nv - 6));
+    us_[t] = u;
+  }
+  handler.updateState(xs_[0].head(nq), xs_[0].tail(nv), false);
+  x0_ = problem_->getProblemState();
+  problem.setInitState(x0_);
+
+  solver_->setup(problem);
+  K0_ = Eigen::MatrixXd::Zero(us_[0].size(), problem.stages_[0]->ndx1());
+  K1_valid_ = false;
+  state_deviation_.resize(problem.stages_[0]->ndx1());
+  // The next tick is solved, and its cost is not compared to the one of the
+  // previous problem
+  last_cost_ = std::numeric_limits<double>::infinity();
+  consecutive_skips_ = settings_.max_skipped_solves;
+}
+
 void MPC::switchToWalk(const Eigen::VectorXd &velocity_base) {
   now_ = WALKING;
   velocity_base_ = velocity_base;
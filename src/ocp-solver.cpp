@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 2-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+#include "simple-mpc/ocp-solver.hpp"
+#include <stdexcept>
+
+namespace simple_mpc {
+
+ProxDDPSolver::ProxDDPSolver(const double tol, const double mu_init,
+                             const std::size_t max_iters,
+                             const std::size_t num_threads)
+    : solver_(tol, mu_init, max_iters, aligator::QUIET) {
+  solver_.rollout_type_ = aligator::RolloutType::LINEAR;
+
+  if (num_threads > 1) {
+    solver_.linear_solver_choice = aligator::LQSolverChoice::PARALLEL;
+    solver_.setNumThreads(num_threads);
+  } else
+    solver_.linear_solver_choice = aligator::LQSolverChoice::SERIAL;
+  solver_.force_initial_condition_ = true;
+  // solver_.reg_min = 1e-6;
+}
+
+FDDPSolver::FDDPSolver(const double tol, const std::size_t max_iters)
+    : solver_(tol, aligator::QUIET, 1e-10, max_iters) {}
+
+AutoSolver::AutoSolver(const double tol, const double mu_init,
+                       const std::size_t max_iters,
+                       const std::size_t num_threads)
+    : proxddp_(tol, mu_init, max_iters, num_threads), fddp_(tol, max_iters),
+      last_(&proxddp_) {}
+
+void AutoSolver::setup(const TrajOptProblem &problem) {
+  proxddp_.setup(problem);
+  fddp_.setup(problem);
+}
+
+void AutoSolver::run(const TrajOptProblem &problem,
+                     const std::vector<Eigen::VectorXd> &xs,
+                     const std::vector<Eigen::VectorXd> &us) {
+  if (hasConstraints(problem))
+    last_ = &proxddp_;
+  else
+    last_ = &fddp_;
+  last_->run(problem, xs, us);
+}
+
+void AutoSolver::cycleProblem(const TrajOptProblem &problem,
+                              const std::shared_ptr<StageData> &data) {
+  proxddp_.cycleProblem(problem, data);
+  fddp_.cycleProblem(problem, data);
+}
+
+void AutoSolver::setMaxIters(const std::size_t max_iters) {
+  proxddp_.setMaxIters(max_iters);
+  fddp_.setMaxIters(max_iters);
+}
+
+bool AutoSolver::hasConstraints(const TrajOptProblem &problem) {
+  if (problem.term_cstrs_.size() > 0)
+    return true;
+  for (auto const &stage : problem.stages_) {
+    if (stage->numConstraints() > 0)
+      return true;
+  }
+  return false;
+}
+
+std::shared_ptr<OCPSolver> createOCPSolver(const SolverBackend backend,
+                                           const double tol,
+                                           const double mu_init,
+                                           const std::size_t max_iters,
+                                           const std::size_t num_threads) {
+  switch (backend) {
+  case SOLVER_PROXDDP:
+    return std::make_shared<ProxDDPSolver>(tol, mu_init, max_iters,
+                                           num_threads);
+  case SOLVER_FDDP:
+    return std::make_shared<FDDPSolver>(tol, max_iters);
+  case SOLVER_AUTO:
+    return std::make_shared<AutoSolver>(tol, mu_init, max_iters, num_threads);
+  }
+  throw std::runtime_error("Unknown solver backend");
+}
+
+} // namespace simple_mpc
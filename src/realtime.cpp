@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 2-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+#include "simple-mpc/realtime.hpp"
+#include <Eigen/Core>
+#include <alloca.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <execinfo.h>
+#include <malloc.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern "C" {
+// Allocation functions of glibc behind malloc, the hooks below forward to
+// them
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+void *__libc_memalign(std::size_t alignment, std::size_t size);
+}
+
+namespace {
+// Initial-exec so that reading them from malloc never allocates the TLS
+// block of the library, even when it is loaded with dlopen
+#define SIMPLE_MPC_TLS thread_local __attribute__((tls_model("initial-exec")))
+SIMPLE_MPC_TLS bool guard_active = false;
+SIMPLE_MPC_TLS std::size_t guard_count = 0;
+SIMPLE_MPC_TLS bool guard_report = false;
+SIMPLE_MPC_TLS bool guard_reporting = false;
+
+// Called from malloc, must not allocate itself
+void onAllocation(const std::size_t size) {
+  if (!guard_active or guard_reporting)
+    return;
+  guard_count++;
+#ifdef SIMPLE_MPC_ALLOCATION_GUARD
+  if (!guard_report)
+    return;
+  guard_reporting = true;
+  char message[96];
+  int length = snprintf(message, sizeof(message),
+                        "simple-mpc: allocation of %zu bytes on the hot path\n",
+                        size);
+  if (length > 0)
+    (void)!write(STDERR_FILENO, message, (std::size_t)length);
+  void *frames[32];
+  int depth = backtrace(frames, 32);
+  backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+
+#ifndef NDEBUG
+  std::abort();
+#endif
+  guard_reporting = false;
+#else
+  (void)size;
+#endif
+}
+} // namespace
+
+// Hooks of the glibc allocation functions, they only add the bookkeeping of
+// the guard. free and the global operator new are left to the C and C++
+// runtimes, the latter allocating through these.
+extern "C" {
+void *malloc(std::size_t size) noexcept {
+  onAllocation(size);
+  return __libc_malloc(size);
+}
+void *calloc(std::size_t count, std::size_t size) noexcept {
+  onAllocation(count * size);
+  return __libc_calloc(count, size);
+}
+void *realloc(void *ptr, std::size_t size) noexcept {
+  onAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+void *memalign(std::size_t alignment, std::size_t size) noexcept {
+  onAllocation(size);
+  return __libc_memalign(alignment, size);
+}
+void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept {
+  onAllocation(size);
+  return __libc_memalign(alignment, size);
+}
+int posix_memalign(void **ptr, std::size_t alignment,
+                   std::size_t size) noexcept {
+  if (alignment % sizeof(void *) != 0 or
+      (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+  onAllocation(size);
+  void *result = __libc_memalign(alignment, size);
+  if (result == nullptr)
+    return ENOMEM;
+  *ptr = result;
+  return 0;
+}
+}
+
+namespace simple_mpc {
+
+void lockMemory(const std::size_t stack_size) {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    throw std::runtime_error("mlockall failed: " +
+                             std::string(std::strerror(errno)));
+  }
+  // Keep freed memory in the process and never serve it through mmap, so that
+  // locked pages are reused instead of new ones being faulted in
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  // Map the stack the control loop will use
+  volatile unsigned char *stack =
+      static_cast<volatile unsigned char *>(alloca(stack_size));
+  for (std::size_t i = 0; i < stack_size; i += (std::size_t)getpagesize())
+    stack[i] = 0;
+
+  // The first backtrace loads libgcc, do it here rather than in the guard
+  void *frames[1];
+  backtrace(frames, 1);
+}
+
+AllocationGuard::AllocationGuard(const bool report)
+    : start_count_(guard_count), was_active_(guard_active),
+      was_reporting_(guard_report) {
+  guard_active = true;
+  guard_report = report;
+#if defined(SIMPLE_MPC_ALLOCATION_GUARD) && defined(EIGEN_RUNTIME_NO_MALLOC)
+  Eigen::internal::set_is_malloc_allowed(!report);
+#endif
+}
+
+AllocationGuard::~AllocationGuard() {
+  guard_active = was_active_;
+  guard_report = was_reporting_;
+#if defined(SIMPLE_MPC_ALLOCATION_GUARD) && defined(EIGEN_RUNTIME_NO_MALLOC)
+  Eigen::internal::set_is_malloc_allowed(!was_reporting_);
+#endif
+}
+
+std::size_t AllocationGuard::getAllocations() const {
+  return guard_count - start_count_;
+}
+
+bool AllocationGuard::isEnabled() {
+  // A library loaded with dlopen, e.g. by the Python module, comes after
+  // the C library in the symbol lookup and its hooks are never called
+  AllocationGuard guard(false);
+  void *volatile ptr = std::malloc(1);
+  std::free(ptr);
+  return guard.getAllocations() > 0;
+}
+
+} // namespace simple_mpc
@@ -4,10 +4,89 @@
 #include <pinocchio/algorithm/centroidal.hpp>
 #include <pinocchio/algorithm/compute-all-terms.hpp>
 #include <pinocchio/algorithm/frames.hpp>
+#include <pinocchio/algorithm/jacobian.hpp>
 #include <pinocchio/parsers/srdf.hpp>
 #include <pinocchio/parsers/urdf.hpp>
 namespace simple_mpc {
 
+FrameKinematicsCache::FrameKinematicsCache(
+    const Model &model, const std::vector<FrameIndex> &frame_ids,
+    const bool local, const bool world_aligned) {
+  initialize(model, frame_ids, local, world_aligned);
+}
+
+void FrameKinematicsCache::initialize(const Model &model,
+                                      const std::vector<FrameIndex> &frame_ids,
+                                      const bool local,
+                                      const bool world_aligned) {
+  local_ = local;
+  world_aligned_ = world_aligned;
+  frame_ids_.clear();
+  v_local_.clear();
+  v_aligned_.clear();
+  J_local_.clear();
+  J_aligned_.clear();
+  dJ_local_.clear();
+  dJ_aligned_.clear();
+  for (auto const id : frame_ids)
+    addFrame(model, id);
+}
+
+void FrameKinematicsCache::addFrame(const Model &model,
+                                    const FrameIndex frame_id) {
+  if (frame_id >= (FrameIndex)model.nframes) {
+    throw std::runtime_error("Frame index exceeds the number of frames");
+  }
+  if (std::find(frame_ids_.begin(), frame_ids_.end(), frame_id) !=
+      frame_ids_.end())
+    return;
+  frame_ids_.push_back(frame_id);
+  v_local_.push_back(Motion::Zero());
+  v_aligned_.push_back(Motion::Zero());
+  J_local_.push_back(Data::Matrix6x::Zero(6, model.nv));
+  J_aligned_.push_back(Data::Matrix6x::Zero(6, model.nv));
+  dJ_local_.push_back(Data::Matrix6x::Zero(6, model.nv));
+  dJ_aligned_.push_back(Data::Matrix6x::Zero(6, model.nv));
+}
+
+void FrameKinematicsCache::update(const Model &model, Data &data) {
+  for (std::size_t i = 0; i < frame_ids_.size(); i++) {
+    const FrameIndex id = frame_ids_[i];
+    // Fills data.oMf[id] as well
+    if (local_) {
+      dJ_local_[i].setZero();
+      getFrameJacobianTimeVariation(model, data, id, LOCAL, dJ_local_[i]);
+    }
+    if (world_aligned_) {
+      dJ_aligned_[i].setZero();
+      getFrameJacobianTimeVariation(model, data, id, LOCAL_WORLD_ALIGNED,
+                                    dJ_aligned_[i]);
+    }
+
+    // World aligned quantities are rotated from the local ones
+    const Eigen::Matrix3d &R = data.oMf[id].rotation();
+    J_local_[i].setZero();
+    getFrameJacobian(model, data, id, LOCAL, J_local_[i]);
+    v_local_[i] = getFrameVelocity(model, data, id, LOCAL);
+    if (world_aligned_) {
+      J_aligned_[i].topRows<3>().noalias() = R * J_local_[i].topRows<3>();
+      J_aligned_[i].bottomRows<3>().noalias() =
+          R * J_local_[i].bottomRows<3>();
+      v_aligned_[i].linear() = R * v_local_[i].linear();
+      v_aligned_[i].angular() = R * v_local_[i].angular();
+    }
+  }
+}
+
+std::size_t FrameKinematicsCache::getSlot(const FrameIndex frame_id) const {
+  for (std::size_t i = 0; i < frame_ids_.size(); i++) {
+    if (frame_ids_[i] == frame_id)
+      return i;
+  }
+  throw std::runtime_error("Frame " + std::to_string(frame_id) +
+                           " is not in the kinematics cache");
+}
+
 RobotHandler::RobotHandler() {}
 
 RobotHandler::RobotHandler(const RobotHandlerSettings &settings) {
@@ -108,8 +187,12 @@ void RobotHandler::initialize(const RobotHandlerSettings &settings) {
     }
   }
   M_.resize(rmodel_.nv, rmodel_.nv);
+  std::vector<FrameIndex> cached_frames = end_effector_ids_;
+  cached_frames.push_back(root_ids_);
+  frame_kinematics_.cache->initialize(rmodel_, cached_frames);
   updateConfiguration(q_, true);
   computeMass();
+  publishModel();
   initialized_ = true;
 }
 
@@ -162,6 +245,16 @@ void RobotHandler::updateJacobiansMassMatrix() {
   make_symmetric(rdata_.M);
   nonLinearEffects(rmodel_, rdata_, q_, v_);
   dccrba(rmodel_, rdata_, q_, v_);
+  frame_kinematics_.cache->update(rmodel_, rdata_);
+}
+
+void RobotHandler::trackFrame(const std::string &frame_name) {
+  if (!rmodel_.existFrame(frame_name)) {
+    throw std::runtime_error("Frame " + frame_name +
+                             " does not belong to the model");
+  }
+  frame_kinematics_.cache->addFrame(rmodel_,
+                                   rmodel_.getFrameId(frame_name));
 }
 
 const Eigen::VectorXd RobotHandler::shapeState(const Eigen::VectorXd &q,
@@ -194,6 +287,73 @@ void RobotHandler::computeMass() {
     mass_ += I.mass();
 }
 
+std::shared_ptr<const Model> RobotHandler::publishModel() {
+  model_snapshot_ = std::make_shared<const Model>(rmodel_);
+  return model_snapshot_;
+}
+
+void RobotHandler::setLinkInertia(const std::string &joint_name,
+                                  const Inertia &inertia) {
+  if (!rmodel_.existJointName(joint_name)) {
+    throw std::runtime_error("Joint " + joint_name +
+                             " does not belong to the model");
+  }
+  rmodel_.inertias[rmodel_.getJointId(joint_name)] = inertia;
+  computeMass();
+}
+
+void RobotHandler::setMass(const double mass) {
+  if (mass <= 0) {
+    throw std::runtime_error("Robot mass must be positive");
+  }
+  const double scale = mass / mass_;
+  for (Inertia &I : rmodel_.inertias)
+    I = Inertia(I.mass() * scale, I.lever(), I.inertia() * scale);
+  computeMass();
+}
+
+Eigen::VectorXd RobotHandler::mapState(const Model &source,
+                                       const Eigen::VectorXd &x) {
+  if (x.size() != source.nq + source.nv) {
+    throw std::runtime_error("State must have the dimensions of the source "
+                             "model");
+  }
+  Eigen::VectorXd x_mapped = Eigen::VectorXd::Zero(rmodel_.nq + rmodel_.nv);
+  for (JointIndex j = 1; j < (JointIndex)rmodel_.njoints; j++) {
+    const std::string &name = rmodel_.names[j];
+    const int nq = rmodel_.nqs[j];
+    const int nv = rmodel_.nvs[j];
+    if (source.existJointName(name)) {
+      const JointIndex k = source.getJointId(name);
+      x_mapped.segment(rmodel_.idx_qs[j], nq) =
+          x.segment(source.idx_qs[k], nq);
+      x_mapped.segment(rmodel_.nq + rmodel_.idx_vs[j], nv) =
+          x.segment(source.nq + source.idx_vs[k], nv);
+    } else {
+      const JointIndex k = rmodel_complete_.getJointId(name);
+      x_mapped.segment(rmodel_.idx_qs[j], nq) =
+          q_complete_.segment(rmodel_complete_.idx_qs[k], nq);
+    }
+  }
+  return x_mapped;
+}
+
+void RobotHandler::mapActuated(const Model &source,
+                               const Eigen::VectorXd &u_source,
+                               Eigen::Ref<Eigen::VectorXd> u) {
+  if (u_source.size() != source.nv - 6 or u.size() != rmodel_.nv - 6) {
+    throw std::runtime_error("Actuated vectors must have nv - 6 entries");
+  }
+  for (JointIndex j = 1; j < (JointIndex)rmodel_.njoints; j++) {
+    const std::string &name = rmodel_.names[j];
+    if (rmodel_.idx_vs[j] < 6 or !source.existJointName(name))
+      continue;
+    const JointIndex k = source.getJointId(name);
+    u.segment(rmodel_.idx_vs[j] - 6, rmodel_.nvs[j]) =
+        u_source.segment(source.idx_vs[k] - 6, rmodel_.nvs[j]);
+  }
+}
+
 Eigen::VectorXd RobotHandler::difference(const Eigen::VectorXd &x1,
                                          const Eigen::VectorXd &x2) {
   Eigen::VectorXd dx = Eigen::VectorXd::Zero(2 * rmodel_.nv);
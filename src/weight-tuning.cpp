@@ -0,0 +1,267 @@
+///////////////////////////////////////////////////////////////////////////////
+// BSD 2-Clause License
+//
+// Copyright (C) 2024, INRIA
+// Copyright note valid unless otherwise stated in individual files.
+// All rights reserved.
+///////////////////////////////////////////////////////////////////////////////
+#include "simple-mpc/weight-tuning.hpp"
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <omp.h>
+#include <stdexcept>
+
+namespace simple_mpc {
+
+CMAES::CMAES(const Eigen::VectorXd &mean, const double sigma,
+             const std::size_t population_size, const unsigned int seed)
+    : n_((std::size_t)mean.size()), mean_(mean), sigma_(sigma),
+      generator_(seed) {
+  if (n_ == 0 or sigma <= 0) {
+    throw std::runtime_error(
+        "CMA-ES needs at least one parameter and a positive step size");
+  }
+  double n = (double)n_;
+  lambda_ = population_size > 0
+                ? population_size
+                : 4 + (std::size_t)std::floor(3 * std::log(n));
+  lambda_ = std::max(lambda_, (std::size_t)2);
+  mu_ = lambda_ / 2;
+
+  weights_.resize((long)mu_);
+  for (std::size_t i = 0; i < mu_; i++)
+    weights_[(long)i] = std::log((double)mu_ + 0.5) - std::log((double)i + 1);
+  weights_ /= weights_.sum();
+  mu_eff_ = 1. / weights_.squaredNorm();
+
+  c_sigma_ = (mu_eff_ + 2) / (n + mu_eff_ + 5);
+  d_sigma_ =
+      1 + 2 * std::max(0., std::sqrt((mu_eff_ - 1) / (n + 1)) - 1) + c_sigma_;
+  c_c_ = (4 + mu_eff_ / n) / (n + 4 + 2 * mu_eff_ / n);
+  c_1_ = 2 / ((n + 1.3) * (n + 1.3) + mu_eff_);
+  c_mu_ = std::min(1 - c_1_, 2 * (mu_eff_ - 2 + 1 / mu_eff_) /
+                                 ((n + 2) * (n + 2) + mu_eff_));
+  chi_n_ = std::sqrt(n) * (1 - 1 / (4 * n) + 1 / (21 * n * n));
+
+  C_ = Eigen::MatrixXd::Identity((long)n_, (long)n_);
+  B_ = Eigen::MatrixXd::Identity((long)n_, (long)n_);
+  D_ = Eigen::VectorXd::Ones((long)n_);
+  p_sigma_ = Eigen::VectorXd::Zero((long)n_);
+  p_c_ = Eigen::VectorXd::Zero((long)n_);
+  z_.assign(lambda_, Eigen::VectorXd::Zero((long)n_));
+  samples_.assign(lambda_, mean_);
+}
+
+const std::vector<Eigen::VectorXd> &CMAES::ask() {
+  for (std::size_t k = 0; k < lambda_; k++) {
+    for (long j = 0; j < (long)n_; j++)
+      z_[k][j] = normal_(generator_);
+    samples_[k] = mean_ + sigma_ * B_ * D_.asDiagonal() * z_[k];
+  }
+  return samples_;
+}
+
+void CMAES::tell(const std::vector<double> &costs) {
+  if (costs.size() != lambda_) {
+    throw std::runtime_error("One cost per sample of the population needed");
+  }
+  std::vector<std::size_t> order(lambda_);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](std::size_t a, std::size_t b) {
+                     return costs[a] < costs[b];
+                   });
+
+  // Weighted mean of the best steps, in sample space (y) and in the
+  // whitened space (z), and their rank-mu covariance
+  Eigen::VectorXd y_w = Eigen::VectorXd::Zero((long)n_);
+  Eigen::VectorXd z_w = Eigen::VectorXd::Zero((long)n_);
+  Eigen::MatrixXd rank_mu = Eigen::MatrixXd::Zero((long)n_, (long)n_);
+  for (std::size_t i = 0; i < mu_; i++) {
+    Eigen::VectorXd y = (samples_[order[i]] - mean_) / sigma_;
+    y_w += weights_[(long)i] * y;
+    z_w += weights_[(long)i] * z_[order[i]];
+    rank_mu += weights_[(long)i] * y * y.transpose();
+  }
+  mean_ += sigma_ * y_w;
+
+  generation_++;
+  // C^-1/2 y_w = B z_w
+  p_sigma_ = (1 - c_sigma_) * p_sigma_ +
+             std::sqrt(c_sigma_ * (2 - c_sigma_) * mu_eff_) * B_ * z_w;
+  const double p_sigma_norm = p_sigma_.norm();
+  const bool h_sigma =
+      p_sigma_norm /
+          std::sqrt(1 - std::pow(1 - c_sigma_, 2. * (double)generation_)) <
+      (1.4 + 2 / ((double)n_ + 1)) * chi_n_;
+  p_c_ = (1 - c_c_) * p_c_;
+  if (h_sigma)
+    p_c_ += std::sqrt(c_c_ * (2 - c_c_) * mu_eff_) * y_w;
+
+  const double correction = h_sigma ? 0. : c_c_ * (2 - c_c_);
+  C_ = (1 - c_1_ - c_mu_) * C_ +
+       c_1_ * (p_c_ * p_c_.transpose() + correction * C_) + c_mu_ * rank_mu;
+  sigma_ *= std::exp((c_sigma_ / d_sigma_) * (p_sigma_norm / chi_n_ - 1));
+
+  C_ = 0.5 * (C_ + C_.transpose());
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(C_);
+  B_ = eig.eigenvectors();
+  D_ = eig.eigenvalues().cwiseMax(1e-20).cwiseSqrt();
+}
+
+WeightTuner::WeightTuner(const TuningSettings &settings,
+                         const MPCFactory &factory,
+                         const std::vector<TunedCost> &costs,
+                         const Objective &objective, const Plant &plant)
+    : settings_(settings), costs_(costs), objective_(objective),
+      plant_(plant) {
+  for (auto const &cost : costs_) {
+    if (cost.diagonal.size() == 0) {
+      throw std::runtime_error("Tuned cost " + cost.name +
+                               " has no weight to tune");
+    }
+    num_parameters_ += (std::size_t)cost.diagonal.size();
+  }
+
+  int num_threads =
+      settings_.num_threads > 0 ? settings_.num_threads : omp_get_max_threads();
+  for (int i = 0; i < num_threads; i++) {
+    std::shared_ptr<MPC> mpc = factory();
+    if (mpc == nullptr) {
+      throw std::runtime_error("MPC factory returned no MPC");
+    }
+    // Also checks the names and sizes of the tuned costs
+    for (auto const &cost : costs_)
+      mpc->setCostWeights(cost.name, cost.diagonal.asDiagonal());
+    workers_.push_back(mpc);
+  }
+  x0_ = workers_[0]->getHandler().getState();
+}
+
+std::map<std::string, Eigen::VectorXd>
+WeightTuner::getWeights(const Eigen::VectorXd &parameters) const {
+  if ((std::size_t)parameters.size() != num_parameters_) {
+    throw std::runtime_error("Expected " + std::to_string(num_parameters_) +
+                             " parameters");
+  }
+  std::map<std::string, Eigen::VectorXd> weights;
+  long start = 0;
+  for (auto const &cost : costs_) {
+    long size = cost.diagonal.size();
+    Eigen::VectorXd multipliers = parameters.segment(start, size).array().exp();
+    weights.insert({cost.name, cost.diagonal.cwiseProduct(multipliers)});
+    start += size;
+  }
+  return weights;
+}
+
+EpisodeStatistics WeightTuner::runEpisode(const Eigen::VectorXd &parameters,
+                                          const std::size_t worker) {
+  MPC &mpc = *workers_.at(worker);
+  for (auto const &cost : getWeights(parameters))
+    mpc.setCostWeights(cost.first, cost.second.asDiagonal());
+
+  const long nq = mpc.getHandler().getModel().nq;
+  const long nv = mpc.getHandler().getModel().nv;
+  Eigen::VectorXd x = x0_;
+  mpc.reset(x.head(nq), x.tail(nv));
+  mpc.switchToWalk(settings_.velocity_base);
+
+  EpisodeStatistics stats;
+  for (std::size_t tick = 0; tick < settings_.episode_length; tick++) {
+    std::chrono::steady_clock::time_point begin =
+        std::chrono::steady_clock::now();
+    mpc.iterate(x.head(nq), x.tail(nv));
+    std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now();
+    double solve_time = std::chrono::duration<double>(end - begin).count();
+    stats.ticks++;
+    stats.mean_solve_time += solve_time;
+    stats.max_solve_time = std::max(stats.max_solve_time, solve_time);
+    if (mpc.getSolutionStatus() != MPC::SOLUTION_OK)
+      stats.rejected_solutions++;
+    stats.effort += mpc.us_[0].squaredNorm();
+
+    plant_(mpc, x);
+    if (!x.allFinite()) {
+      stats.diverged = true;
+      break;
+    }
+    // Free-flyer velocity is expressed in the base frame
+    Eigen::Quaterniond quat(x.segment<4>(3));
+    Eigen::Matrix3d rotation = quat.normalized().toRotationMatrix();
+    stats.tracking_error +=
+        (rotation * x.segment<3>(nq) - settings_.velocity_base.head(3))
+            .squaredNorm() +
+        (rotation * x.segment<3>(nq + 3) - settings_.velocity_base.tail(3))
+            .squaredNorm();
+  }
+  stats.mean_solve_time /= (double)std::max(stats.ticks, (std::size_t)1);
+  return stats;
+}
+
+TuningResult WeightTuner::optimize() {
+  CMAES cmaes(Eigen::VectorXd::Zero((long)num_parameters_),
+              settings_.initial_step, settings_.population_size,
+              settings_.seed);
+  const std::size_t lambda = cmaes.getPopulationSize();
+  const double bound = settings_.max_log_multiplier;
+
+  TuningResult result;
+  result.best_parameters = cmaes.getMean();
+  result.best_objective = std::numeric_limits<double>::infinity();
+
+  std::vector<Eigen::VectorXd> candidates(lambda);
+  std::vector<EpisodeStatistics> stats(lambda);
+  std::vector<double> costs(lambda);
+  for (std::size_t g = 0; g < settings_.generations; g++) {
+    const std::vector<Eigen::VectorXd> &samples = cmaes.ask();
+
+#pragma omp parallel for num_threads((int)workers_.size()) schedule(dynamic)
+    for (long i = 0; i < (long)lambda; i++) {
+      std::size_t k = (std::size_t)i;
+      // Out-of-bound samples are evaluated on the bound and penalized by
+      // their distance to it
+      candidates[k] = samples[k].cwiseMax(-bound).cwiseMin(bound);
+      double penalty = (samples[k] - candidates[k]).squaredNorm();
+      try {
+        stats[k] = runEpisode(candidates[k], (std::size_t)omp_get_thread_num());
+        costs[k] = objective_(stats[k]) + penalty;
+      } catch (const std::exception &) {
+        stats[k] = EpisodeStatistics();
+        stats[k].diverged = true;
+        costs[k] = std::numeric_limits<double>::infinity();
+      }
+    }
+
+    std::size_t best =
+        (std::size_t)(std::min_element(costs.begin(), costs.end()) -
+                      costs.begin());
+    result.history.push_back(costs[best]);
+    if (costs[best] < result.best_objective) {
+      result.best_objective = costs[best];
+      result.best_parameters = candidates[best];
+      result.best_statistics = stats[best];
+    }
+    cmaes.tell(costs);
+  }
+  result.best_weights = getWeights(result.best_parameters);
+  return result;
+}
+
+void WeightTuner::predictionPlant(MPC &mpc, Eigen::VectorXd &x) {
+  x = mpc.xs_[1];
+}
+
+double WeightTuner::defaultObjective(const EpisodeStatistics &stats) {
+  if (stats.diverged)
+    return 1e6;
+  return (stats.tracking_error + 1e-6 * stats.effort) /
+         (double)std::max(stats.ticks, (std::size_t)1);
+}
+
+} // namespace simple_mpc
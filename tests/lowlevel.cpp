@@ -2,6 +2,7 @@
 #include <boost/test/unit_test.hpp>
 #include <proxsuite-nlp/manifold-base.hpp>
 
+#include "simple-mpc/lowlevel-batch.hpp"
 #include "simple-mpc/lowlevel-control.hpp"
 #include "simple-mpc/robot-handler.hpp"
 #include "test_utils.cpp"
@@ -10,6 +11,56 @@ BOOST_AUTO_TEST_SUITE(lowlevel)
 
 using namespace simple_mpc;
 
+// Joint block of the IKID Hessian and gradient assembled densely, one task
+// at a time, from the same Jacobians and differences as the solver
+class IKIDDenseAssembly : public IKIDSolver {
+public:
+  using IKIDSolver::IKIDSolver;
+
+  void assemble(const pinocchio::Data &data, const Eigen::VectorXd &v,
+                const Eigen::VectorXd &dH, Eigen::MatrixXd &H,
+                Eigen::VectorXd &g) {
+    const long nv = model_->nv;
+    const FrameKinematicsCache &kinematics =
+        shared_kinematics_ == nullptr ? kinematics_ : *shared_kinematics_;
+
+    H = settings_.w_qref * Eigen::MatrixXd::Identity(nv, nv);
+    H += settings_.w_centroidal * data.Ag.transpose() * data.Ag;
+    g = settings_.w_qref * (-settings_.Kp_gains[0].cwiseProduct(q_diff_) -
+                            settings_.Kd_gains[0].cwiseProduct(dq_diff_));
+    g -= settings_.w_centroidal *
+         ((dH - data.dAg * v).transpose() * data.Ag).transpose();
+
+    for (std::size_t i = 0; i < settings_.contact_ids.size(); i++) {
+      const Eigen::MatrixXd J =
+          kinematics.getJacobian(contact_slots_[i]).topRows(fs_);
+      const Eigen::MatrixXd dJ =
+          kinematics.getJacobianTimeVariation(contact_slots_[i]).topRows(fs_);
+      H += settings_.w_footpose * J.transpose() * J;
+      g += settings_.w_footpose *
+           ((dJ * v -
+             settings_.Kp_gains[1].cwiseProduct(foot_diffs_[i].topRows(fs_)) -
+             settings_.Kd_gains[1].cwiseProduct(dfoot_diffs_[i].topRows(fs_)))
+                .transpose() *
+            J)
+               .transpose();
+    }
+    for (std::size_t i = 0; i < settings_.fixed_frame_ids.size(); i++) {
+      const Eigen::MatrixXd J =
+          kinematics.getJacobian(frame_slots_[i]).bottomRows(3);
+      const Eigen::MatrixXd dJ =
+          kinematics.getJacobianTimeVariation(frame_slots_[i]).bottomRows(3);
+      H += settings_.w_baserot * J.transpose() * J;
+      g += settings_.w_baserot *
+           ((dJ * v - settings_.Kp_gains[2].cwiseProduct(frame_diffs_[i]) -
+             settings_.Kd_gains[2].cwiseProduct(dframe_diffs_[i]))
+                .transpose() *
+            J)
+               .transpose();
+    }
+  }
+};
+
 BOOST_AUTO_TEST_CASE(ID_solver) {
   RobotHandler handler = getTalosHandler();
 
@@ -37,6 +88,72 @@ BOOST_AUTO_TEST_CASE(ID_solver) {
   Eigen::MatrixXd M = handler.getMassMatrix();
   pinocchio::Data rdata = handler.getData();
   ID_solver.solve_qp(rdata, contact_states, v, a, forces, M);
+
+  // Forces well inside the friction cones are handled without the QP
+  forces.setZero();
+  forces[2] = forces[8] = handler.getMass() * 9.81 / 2;
+  ID_solver.solve_qp(rdata, contact_states, v, a, forces, M);
+  BOOST_CHECK(ID_solver.getClosedFormRate() > 0);
+  BOOST_CHECK(ID_solver.solved_torque_.allFinite());
+
+  settings.closed_form = false;
+  IDSolver QP_solver(settings, handler.getModel());
+  QP_solver.solve_qp(rdata, contact_states, v, a, forces, M);
+  BOOST_CHECK_EQUAL(QP_solver.getClosedFormRate(), 0);
+
+  // A solver reading the cache of a handler keeps it past the handler, and
+  // a copy of the handler has a cache of its own
+  IDSolver shared_solver(settings, handler.getModelHandle());
+  {
+    RobotHandler copy = handler;
+    BOOST_CHECK(copy.getFrameKinematicsHandle() !=
+                handler.getFrameKinematicsHandle());
+    shared_solver.useFrameKinematics(copy.getFrameKinematicsHandle());
+  }
+  shared_solver.solve_qp(rdata, contact_states, v, a, forces, M);
+  BOOST_CHECK(shared_solver.solved_torque_.isApprox(QP_solver.solved_torque_));
+}
+
+BOOST_AUTO_TEST_CASE(ID_batch_solver) {
+  RobotHandler handler = getTalosHandler();
+
+  IDSettings settings;
+  settings.contact_ids = handler.getFeetIds();
+  settings.mu = 0.8;
+  settings.Lfoot = 0.1;
+  settings.Wfoot = 0.075;
+  settings.force_size = 6;
+  settings.kd = 10;
+  settings.w_force = 1000;
+  settings.w_acc = 1;
+  settings.verbose = false;
+
+  std::size_t batch_size = 4;
+  IDSolver ID_solver(settings, handler.getModel());
+  IDBatchSolver batch_solver(settings, handler.getModel(), batch_size, 2);
+
+  long nv = handler.getModel().nv;
+  Eigen::VectorXd v = Eigen::VectorXd::Random(nv);
+  Eigen::VectorXd a = Eigen::VectorXd::Random(nv);
+  Eigen::VectorXd forces = Eigen::VectorXd::Random(6 * 2);
+  std::vector<bool> contact_state = {true, false};
+
+  pinocchio::Data rdata = handler.getData();
+  ID_solver.solve_qp(rdata, contact_state, v, a, forces, rdata.M);
+
+  std::vector<pinocchio::Data> datas(batch_size, handler.getData());
+  std::vector<std::vector<bool>> contact_states(batch_size, contact_state);
+  batch_solver.solve(datas, contact_states,
+                     v.replicate(1, (long)batch_size),
+                     a.replicate(1, (long)batch_size),
+                     forces.replicate(1, (long)batch_size));
+
+  for (long i = 0; i < (long)batch_size; i++) {
+    BOOST_CHECK(batch_solver.solved_torque_.col(i).isApprox(
+        ID_solver.solved_torque_));
+    BOOST_CHECK(
+        batch_solver.solved_acc_.col(i).isApprox(ID_solver.solved_acc_));
+  }
 }
 
 BOOST_AUTO_TEST_CASE(IKID_solver) {
@@ -78,7 +195,12 @@ BOOST_AUTO_TEST_CASE(IKID_solver) {
   settings.w_force = 100;
   settings.verbose = false;
 
-  IKIDSolver IKID_solver(settings, handler.getModel());
+  IKIDDenseAssembly IKID_solver(settings, handler.getModelHandle());
+  // Snapshots of another model are refused
+  IKID_solver.updateModel(handler.publishModel());
+  BOOST_CHECK_THROW(
+      IKID_solver.updateModel(std::make_shared<const pinocchio::Model>()),
+      std::runtime_error);
 
   std::vector<bool> contact_states;
   contact_states.push_back(true);
@@ -109,6 +231,17 @@ BOOST_AUTO_TEST_CASE(IKID_solver) {
 
   IKID_solver.computeDifferences(rdata, xm, foot_refs, foot_refs_next);
   IKID_solver.solve_qp(rdata, contact_states, dv, forces, dH, M);
+
+  Eigen::MatrixXd H = IKID_solver.getQP().H;
+  BOOST_CHECK(H.isApprox(H.transpose()));
+
+  // Same joint block as the dense assembly
+  const long nv = handler.getModel().nv;
+  Eigen::MatrixXd H_dense;
+  Eigen::VectorXd g_dense;
+  IKID_solver.assemble(rdata, dv, dH, H_dense, g_dense);
+  BOOST_CHECK(H.topLeftCorner(nv, nv).isApprox(H_dense, 1e-10));
+  BOOST_CHECK(IKID_solver.getQP().g.head(nv).isApprox(g_dense, 1e-10));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include "simple-mpc/fwd.hpp"
 #include "simple-mpc/kinodynamics.hpp"
 #include "simple-mpc/mpc.hpp"
+#include "simple-mpc/realtime.hpp"
 #include "simple-mpc/robot-handler.hpp"
 #include "test_utils.cpp"
 
@@ -70,6 +71,13 @@ BOOST_AUTO_TEST_CASE(mpc_fulldynamics) {
   }
 
   mpc.generateCycleHorizon(contact_states);
+  // Generating again replaces the cycle instead of appending to it
+  mpc.generateCycleHorizon(contact_states);
+  BOOST_CHECK_EQUAL(mpc.getCycleHorizon().size(), contact_states.size());
+  BOOST_CHECK_EQUAL(mpc.foot_takeoff_times_.at("left_sole_link").size(), 1);
+  // Nodes with the same contact pattern share their stage model
+  BOOST_CHECK(mpc.getCycleHorizon()[20] == mpc.getCycleHorizon()[30]);
+  BOOST_CHECK(mpc.getCycleHorizon()[20] != mpc.getCycleHorizon()[80]);
 
   BOOST_CHECK_EQUAL(mpc.foot_takeoff_times_.at("left_sole_link")[0], 170);
   BOOST_CHECK_EQUAL(mpc.foot_takeoff_times_.at("right_sole_link")[0], 110);
@@ -84,6 +92,35 @@ BOOST_AUTO_TEST_CASE(mpc_fulldynamics) {
   BOOST_CHECK_EQUAL(mpc.foot_takeoff_times_.at("right_sole_link")[0], 100);
   BOOST_CHECK_EQUAL(mpc.foot_land_times_.at("left_sole_link")[0], 209);
   BOOST_CHECK_EQUAL(mpc.foot_land_times_.at("right_sole_link")[0], 150);
+
+  Eigen::MatrixXd w_frame = settings.w_frame * 0.5;
+  mpc.setCostWeights("left_sole_link_pose_cost", w_frame);
+  QuadraticResidualCost *qrc =
+      problem->getCostStack(T - 1)->getComponent<QuadraticResidualCost>(
+          "left_sole_link_pose_cost");
+  BOOST_CHECK_EQUAL(qrc->weights_, w_frame);
+  for (auto const &sm : mpc.getCycleHorizon()) {
+    CostStack *cs = dynamic_cast<CostStack *>(&*sm->cost_);
+    BOOST_CHECK_EQUAL(
+        cs->getComponent<QuadraticResidualCost>("left_sole_link_pose_cost")
+            ->weights_,
+        w_frame);
+  }
+
+  mpc.setHorizonLength(80);
+  BOOST_CHECK_EQUAL(problem->getSize(), 80);
+  BOOST_CHECK_EQUAL(mpc.xs_.size(), 81);
+  BOOST_CHECK_EQUAL(mpc.us_.size(), 80);
+  BOOST_CHECK_EQUAL(mpc.getFootLandCycle("left_sole_link"), -1);
+  mpc.iterate(handler.getState().head(handler.getModel().nq),
+              handler.getState().tail(handler.getModel().nv));
+
+  mpc.setHorizonLength(T);
+  BOOST_CHECK_EQUAL(problem->getSize(), T);
+  BOOST_CHECK_EQUAL(mpc.xs_.size(), T + 1);
+  BOOST_CHECK_EQUAL(mpc.foot_takeoff_times_.at("left_sole_link")[0], 159);
+  BOOST_CHECK_EQUAL(mpc.foot_land_times_.at("left_sole_link")[0], 208);
+  BOOST_CHECK_THROW(mpc.setHorizonLength(T + 1), std::runtime_error);
 }
 
 BOOST_AUTO_TEST_CASE(mpc_kinodynamics) {
@@ -154,6 +191,45 @@ BOOST_AUTO_TEST_CASE(mpc_kinodynamics) {
     mpc.iterate(handler.getState().head(handler.getModel().nq),
                 handler.getState().tail(handler.getModel().nv));
   }
+
+  // A diverging solve must leave the previous plan in place, with the
+  // feedback of its second stage
+  std::size_t rejected = mpc.getRejectedSolutions();
+  std::vector<Eigen::VectorXd> us_prev = mpc.us_;
+  const Eigen::MatrixXd K1_prev =
+      mpc.getOCPSolver().getResults().getCtrlFeedbacks()[1];
+  Eigen::MatrixXd w_u = settings.w_u;
+  w_u(0, 0) = std::numeric_limits<double>::quiet_NaN();
+  mpc.setCostWeights("control_cost", w_u);
+  mpc.iterate(handler.getState().head(handler.getModel().nq),
+              handler.getState().tail(handler.getModel().nv));
+  BOOST_CHECK(mpc.getSolutionStatus() != MPC::SOLUTION_OK);
+  BOOST_CHECK_EQUAL(mpc.getRejectedSolutions(), rejected + 1);
+  BOOST_CHECK(mpc.us_[0].isApprox(us_prev[1]));
+  BOOST_CHECK(mpc.K0_.isApprox(K1_prev));
+
+  // The plan recovers once the weights are sound again
+  mpc.setCostWeights("control_cost", settings.w_u);
+  mpc.iterate(handler.getState().head(handler.getModel().nq),
+              handler.getState().tail(handler.getModel().nv));
+  BOOST_CHECK_EQUAL(mpc.getSolutionStatus(), MPC::SOLUTION_OK);
+  BOOST_CHECK_EQUAL(mpc.getRejectedSolutions(), rejected + 1);
+  BOOST_CHECK(mpc.K0_.allFinite());
+  BOOST_CHECK(mpc.us_[0].allFinite());
+
+  // Multipliers of a rejected run are not warm-started from
+  mpc.getSolver().results_.lams[1].setConstant(
+      std::numeric_limits<double>::quiet_NaN());
+  mpc.iterate(handler.getState().head(handler.getModel().nq),
+              handler.getState().tail(handler.getModel().nv));
+  BOOST_CHECK(mpc.getSolutionStatus() != MPC::SOLUTION_OK);
+  BOOST_CHECK_EQUAL(mpc.getRejectedSolutions(), rejected + 2);
+  for (auto const &lam : mpc.getSolver().results_.lams)
+    BOOST_CHECK(lam.allFinite());
+  mpc.iterate(handler.getState().head(handler.getModel().nq),
+              handler.getState().tail(handler.getModel().nv));
+  BOOST_CHECK_EQUAL(mpc.getSolutionStatus(), MPC::SOLUTION_OK);
+  BOOST_CHECK_EQUAL(mpc.getRejectedSolutions(), rejected + 2);
 }
 
 BOOST_AUTO_TEST_CASE(mpc_centroidal) {
@@ -229,4 +305,678 @@ BOOST_AUTO_TEST_CASE(mpc_centroidal) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(mpc_blocking) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  FullDynamicsProblem fdproblem(settings, handler);
+
+  // 40 stages of one node and 10 of two cover the 60 nodes of a full horizon
+  size_t T = 50;
+  size_t nodes = 60;
+  fdproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(fdproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  mpc_settings.blocking_start = 40;
+  mpc_settings.blocking_factor = 2;
+
+  MPC mpc = MPC(mpc_settings, problem);
+  BOOST_CHECK_EQUAL(mpc.getHorizonNodes(), nodes);
+  BOOST_CHECK_EQUAL(mpc.getStageNode(39), 39);
+  BOOST_CHECK_EQUAL(mpc.getStageNode(41), 42);
+
+  std::vector<std::map<std::string, bool>> contact_states;
+  for (std::size_t i = 0; i < 40; i++) {
+    std::map<std::string, bool> contact_state;
+    contact_state.insert({handler.getFootName(0), i < 30});
+    contact_state.insert({handler.getFootName(1), i >= 10});
+    contact_states.push_back(contact_state);
+  }
+  mpc.generateCycleHorizon(contact_states);
+
+  // After k recedes, node m of the horizon is entry m - (nodes - k) of the
+  // cycle, the nodes before it are standing. Each stage has the contacts of
+  // the node it starts at, in the blocked region as well.
+  for (std::size_t k = 1; k <= 70; k++) {
+    mpc.recedeWithCycle();
+    for (std::size_t t = 0; t < T; t++) {
+      const long entry = (long)mpc.getStageNode(t) - (long)(nodes - k);
+      for (std::size_t j = 0; j < 2; j++) {
+        const std::string name = handler.getFootName(j);
+        const bool contact =
+            entry < 0 or contact_states[(std::size_t)entry % 40].at(name);
+        const CostStack::CostKey key(name + "_force_cost");
+        BOOST_CHECK_EQUAL(problem->getCostStack(t)->components_.count(key),
+                          contact ? 1 : 0);
+      }
+    }
+  }
+  // Events are counted in nodes: the first takeoff of foot 0, at entry 30,
+  // entered the horizon as its last node at the 31st recede
+  BOOST_CHECK_EQUAL(mpc.getFootTakeoffCycle(handler.getFootName(0)),
+                    (int)(nodes + 30) - 70);
+
+  for (std::size_t i = 0; i < 5; i++) {
+    mpc.iterate(handler.getState().head(handler.getModel().nq),
+                handler.getState().tail(handler.getModel().nv));
+  }
+  for (std::size_t t = 0; t < T; t++) {
+    BOOST_CHECK(mpc.xs_[t].allFinite());
+    BOOST_CHECK(mpc.us_[t].allFinite());
+  }
+
+  // Blocked stages are scaled once from their template, and the stage
+  // leaving the blocked region is back to the template values
+  for (std::size_t i = 0; i < T; i++) {
+    double dt = problem->getProblem()
+                    ->stages_[i]
+                    ->getDynamics<IntegratorSemiImplEuler>()
+                    ->timestep_;
+    BOOST_CHECK_EQUAL(dt, i < 40 ? settings.DT : 2 * settings.DT);
+  }
+  BOOST_CHECK_EQUAL(
+      problem->getCostStack(39)->components_.begin()->second.second, 1.);
+  BOOST_CHECK_EQUAL(
+      problem->getCostStack(40)->components_.begin()->second.second, 2.);
+}
+
+BOOST_AUTO_TEST_CASE(mpc_active_forces) {
+  RobotHandler handler = getTalosHandler();
+
+  KinodynamicsSettings settings = getKinodynamicsSettings(handler);
+  settings.active_forces_only = true;
+  KinodynamicsProblem kinoproblem(settings, handler);
+  std::size_t T = 20;
+  kinoproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<KinodynamicsProblem>(kinoproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  // Skipped ticks keep the feedback of the previous first stage
+  mpc_settings.skip_state_tol = 1e6;
+  mpc_settings.max_skipped_solves = 2;
+
+  MPC mpc = MPC(mpc_settings, problem);
+
+  std::vector<std::map<std::string, bool>> contact_states;
+  for (std::size_t i = 0; i < 10; i++) {
+    std::map<std::string, bool> contact_state;
+    contact_state.insert({handler.getFootName(0), true});
+    contact_state.insert({handler.getFootName(1), true});
+    contact_states.push_back(contact_state);
+  }
+  for (std::size_t i = 0; i < 20; i++) {
+    std::map<std::string, bool> contact_state;
+    contact_state.insert({handler.getFootName(0), true});
+    contact_state.insert({handler.getFootName(1), false});
+    contact_states.push_back(contact_state);
+  }
+  mpc.generateCycleHorizon(contact_states);
+
+  // The first stage goes through single support
+  for (std::size_t i = 0; i < T + 15; i++) {
+    mpc.iterate(handler.getState().head(handler.getModel().nq),
+                handler.getState().tail(handler.getModel().nv));
+    const long nu = (long)mpc.getTrajOptProblem().stages_[0]->nu();
+    BOOST_CHECK_EQUAL(mpc.us_[0].size(), nu);
+    BOOST_CHECK_EQUAL(mpc.K0_.rows(), nu);
+    BOOST_CHECK_EQUAL(mpc.getFullControl(0).size(), problem->getNu());
+    BOOST_CHECK_EQUAL(mpc.getFullFeedback().rows(), problem->getNu());
+  }
+  BOOST_CHECK(mpc.getTrajOptProblem().stages_[0]->nu() < problem->getNu());
+  BOOST_CHECK(mpc.getSkippedSolves() > 0);
+
+  // The swing foot has no force in the full layout
+  const Eigen::VectorXd u = mpc.getFullControl(0);
+  const int fs = settings.force_size;
+  BOOST_CHECK(u.segment(fs, fs).isZero());
+  BOOST_CHECK(mpc.getFullFeedback().middleRows(fs, fs).isZero());
+}
+
+BOOST_AUTO_TEST_CASE(mpc_skip_solve) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  FullDynamicsProblem fdproblem(settings, handler);
+
+  size_t T = 50;
+  fdproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(fdproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  // Any deviation is accepted, only the bound on consecutive skips applies
+  mpc_settings.skip_state_tol = 1e6;
+  mpc_settings.max_skipped_solves = 2;
+
+  MPC mpc = MPC(mpc_settings, problem);
+
+  std::vector<std::map<std::string, bool>> contact_states;
+  for (std::size_t i = 0; i < 40; i++) {
+    std::map<std::string, bool> contact_state;
+    contact_state.insert({handler.getFootName(0), true});
+    contact_state.insert({handler.getFootName(1), true});
+    contact_states.push_back(contact_state);
+  }
+  mpc.generateCycleHorizon(contact_states);
+
+  for (std::size_t i = 0; i < 6; i++) {
+    mpc.iterate(handler.getState().head(handler.getModel().nq),
+                handler.getState().tail(handler.getModel().nv));
+    BOOST_CHECK_EQUAL(mpc.isSolveSkipped(), i % 3 != 2);
+  }
+  BOOST_CHECK_EQUAL(mpc.getSkippedSolves(), 4);
+  BOOST_CHECK_CLOSE(mpc.getSkipRate(), 4. / 6., 1e-9);
+
+  // A new velocity command forces a solve
+  Eigen::VectorXd velocity_base = Eigen::VectorXd::Zero(6);
+  velocity_base[0] = 0.2;
+  mpc.setVelocityBase(velocity_base);
+  mpc.iterate(handler.getState().head(handler.getModel().nq),
+              handler.getState().tail(handler.getModel().nv));
+  BOOST_CHECK(!mpc.isSolveSkipped());
+}
+
+BOOST_AUTO_TEST_CASE(mpc_realtime) {
+  // The test links the library, every allocation goes through its hook
+  BOOST_REQUIRE(AllocationGuard::isEnabled());
+  Eigen::VectorXd a = Eigen::VectorXd::Ones(100);
+  Eigen::VectorXd b(100);
+  {
+    AllocationGuard guard(false);
+    b = 2. * a;
+    BOOST_CHECK_EQUAL(guard.getAllocations(), 0);
+    Eigen::VectorXd c = a;
+    std::vector<double> d(10);
+    BOOST_CHECK_EQUAL(guard.getAllocations(), 2);
+  }
+
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  FullDynamicsProblem fdproblem(settings, handler);
+  size_t T = 20;
+  fdproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(fdproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+
+  MPC mpc = MPC(mpc_settings, problem);
+  std::vector<std::map<std::string, bool>> contact_states;
+  for (std::size_t i = 0; i < 10; i++) {
+    std::map<std::string, bool> contact_state;
+    contact_state.insert({handler.getFootName(0), true});
+    contact_state.insert({handler.getFootName(1), true});
+    contact_states.push_back(contact_state);
+  }
+  mpc.generateCycleHorizon(contact_states);
+
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  // Once warm, only the recede allocates, to copy the appended stage
+  for (std::size_t i = 0; i < 5; i++)
+    mpc.iterate(q, v);
+  for (std::size_t i = 0; i < 5; i++) {
+    mpc.iterate(q, v);
+    BOOST_CHECK_EQUAL(mpc.getTickAllocations(),
+                      mpc.getTickRecedeAllocations());
+  }
+  BOOST_CHECK_EQUAL(mpc.getHotPathAllocations(), 0);
+  BOOST_CHECK(mpc.xs_[1].allFinite());
+}
+
+BOOST_AUTO_TEST_CASE(mpc_timed_iterate) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  FullDynamicsProblem fdproblem(settings, handler);
+
+  size_t T = 50;
+  fdproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(fdproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  mpc_settings.dt = 0.01;
+
+  MPC mpc = MPC(mpc_settings, problem);
+
+  std::vector<std::map<std::string, bool>> contact_states;
+  for (std::size_t i = 0; i < 40; i++) {
+    std::map<std::string, bool> contact_state;
+    contact_state.insert({handler.getFootName(0), i < 10});
+    contact_state.insert({handler.getFootName(1), true});
+    contact_states.push_back(contact_state);
+  }
+  mpc.generateCycleHorizon(contact_states);
+  const std::string foot = handler.getFootName(0);
+  const int takeoff = mpc.getFootTakeoffCycle(foot);
+
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+
+  // The first call starts the clock
+  mpc.iterate(q, v, 1.);
+  BOOST_CHECK_EQUAL(mpc.getFootTakeoffCycle(foot), takeoff);
+
+  // One node and a half
+  mpc.iterate(q, v, 1.015);
+  BOOST_CHECK_EQUAL(mpc.getFootTakeoffCycle(foot), takeoff - 1);
+  BOOST_CHECK_CLOSE(mpc.getNodePhase(), 0.5, 1e-6);
+
+  // The remainder completes the third node
+  mpc.iterate(q, v, 1.04);
+  BOOST_CHECK_EQUAL(mpc.getFootTakeoffCycle(foot), takeoff - 4);
+  BOOST_CHECK_SMALL(mpc.getNodePhase(), 1e-6);
+
+  // Less than a node does not shift the plan, a rejected solve keeps the
+  // feedback of its first stage
+  const Eigen::MatrixXd K0 = mpc.K0_;
+  Eigen::MatrixXd w_u = settings.w_u;
+  w_u(0, 0) = std::numeric_limits<double>::quiet_NaN();
+  mpc.setCostWeights("control_cost", w_u);
+  mpc.iterate(q, v, 1.045);
+  BOOST_CHECK(mpc.getSolutionStatus() != MPC::SOLUTION_OK);
+  BOOST_CHECK_EQUAL(mpc.getFootTakeoffCycle(foot), takeoff - 4);
+  BOOST_CHECK(mpc.K0_.isApprox(K0));
+  mpc.setCostWeights("control_cost", settings.w_u);
+
+  BOOST_CHECK_THROW(mpc.iterate(q, v, 1.), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(mpc_contact_plan) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  FullDynamicsProblem fdproblem(settings, handler);
+
+  size_t T = 50;
+  fdproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(fdproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  mpc_settings.dt = 0.01;
+
+  MPC mpc = MPC(mpc_settings, problem);
+  mpc.switchToStand();
+
+  // No cycle: the plan runs, then the MPC stands
+  const std::string foot = handler.getFootName(0);
+  mpc.appendFootsteps({foot}, 20, 10);
+  BOOST_CHECK_EQUAL(mpc.getContactPlanSize(), 30);
+  BOOST_CHECK_EQUAL(mpc.getFootTakeoffCycle(foot), (int)T);
+  BOOST_CHECK_EQUAL(mpc.getFootLandCycle(foot), (int)T + 20);
+  BOOST_CHECK_THROW(mpc.setHorizonLength(T - 10), std::runtime_error);
+
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  mpc.iterate(q, v);
+  BOOST_CHECK_EQUAL(mpc.getContactPlanSize(), 29);
+  BOOST_CHECK_EQUAL(mpc.getFootTakeoffCycle(foot), (int)T - 1);
+  BOOST_CHECK_EQUAL(problem->getContactSupport(T - 1), 1);
+
+  // Nodes of a pattern share their stage template
+  for (std::size_t i = 0; i < 29; i++)
+    mpc.iterate(q, v);
+  BOOST_CHECK_EQUAL(mpc.getContactPlanSize(), 0);
+  BOOST_CHECK_EQUAL(problem->getContactSupport(T - 1), 2);
+  BOOST_CHECK_EQUAL(problem->getContactSupport(T - 11), 1);
+  BOOST_CHECK_EQUAL(mpc.getFootLandCycle(foot), (int)T - 10);
+
+  mpc.iterate(q, v);
+  BOOST_CHECK_EQUAL(problem->getContactSupport(T - 1), 2);
+
+  // Cleared plans leave no event behind the horizon
+  mpc.appendFootsteps({foot}, 20, 10);
+  mpc.clearContactPlan();
+  BOOST_CHECK_EQUAL(mpc.getContactPlanSize(), 0);
+  BOOST_CHECK_LT(mpc.getFootLandCycle(foot), (int)T);
+}
+
+BOOST_AUTO_TEST_CASE(mpc_contact_schedule) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  size_t T = 20;
+  // One problem per MPC, the copies of a problem share their stages
+  std::shared_ptr<Problem> map_problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  std::shared_ptr<Problem> schedule_problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  for (auto &p : {map_problem, schedule_problem})
+    p->createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  MPC map_mpc = MPC(mpc_settings, map_problem);
+  MPC schedule_mpc = MPC(mpc_settings, schedule_problem);
+
+  // The first foot of getFeetNames swings, the columns follow that order
+  const std::vector<std::string> &feet = handler.getFeetNames();
+  MPC::ContactSchedule schedule(25, 2);
+  schedule.setConstant(true);
+  schedule.bottomLeftCorner(15, 1).setConstant(false);
+  std::vector<std::map<std::string, bool>> contact_states;
+  for (long i = 0; i < schedule.rows(); i++) {
+    contact_states.push_back(
+        {{feet[0], schedule(i, 0)}, {feet[1], schedule(i, 1)}});
+  }
+  map_mpc.generateCycleHorizon(contact_states);
+  schedule_mpc.generateCycleHorizon(schedule);
+  BOOST_CHECK_EQUAL(schedule_mpc.getCycleHorizon().size(), 25);
+
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  for (std::size_t i = 0; i < 30; i++) {
+    for (auto const &name : feet) {
+      BOOST_CHECK_EQUAL(schedule_mpc.getFootTakeoffCycle(name),
+                        map_mpc.getFootTakeoffCycle(name));
+      BOOST_CHECK_EQUAL(schedule_mpc.getFootLandCycle(name),
+                        map_mpc.getFootLandCycle(name));
+    }
+    BOOST_CHECK_EQUAL(schedule_problem->getContactSupport(T - 1),
+                      map_problem->getContactSupport(T - 1));
+    map_mpc.iterate(q, v);
+    schedule_mpc.iterate(q, v);
+  }
+  BOOST_CHECK_EQUAL(schedule_mpc.getFootTakeoffCycle(feet[1]), -1);
+
+  MPC::ContactSchedule wrong(25, 3);
+  wrong.setConstant(true);
+  BOOST_CHECK_THROW(schedule_mpc.generateCycleHorizon(wrong),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(mpc_update_inertias) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  FullDynamicsProblem fdproblem(settings, handler);
+
+  size_t T = 20;
+  fdproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(fdproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+
+  MPC mpc = MPC(mpc_settings, problem);
+  const std::string foot = handler.getFootName(0);
+  const double mass = handler.getMass();
+  const Eigen::VectorXd force = problem->getReferenceForce(3, foot);
+
+  mpc.setMass(1.5 * mass);
+  BOOST_CHECK_CLOSE(mpc.getHandler().getMass(), 1.5 * mass, 1e-9);
+  BOOST_CHECK_CLOSE(mpc.getSettings().support_force,
+                    1.5 * mpc_settings.support_force, 1e-9);
+  BOOST_CHECK(problem->getReferenceForce(3, foot).isApprox(1.5 * force));
+  // The handler given to the problem is a copy
+  BOOST_CHECK_CLOSE(handler.getMass(), mass, 1e-9);
+
+  // The horizon keeps its stages and the MPC keeps running
+  BOOST_CHECK_EQUAL(problem->getSize(), T);
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  mpc.iterate(q, v);
+  BOOST_CHECK(mpc.xs_[1].allFinite());
+
+  // Converged plans match the ones of a problem built on the heavier robot
+  RobotHandler heavy = handler;
+  heavy.setMass(1.5 * mass);
+  FullDynamicsProblem heavy_fdproblem(getFullDynamicsSettings(heavy), heavy);
+  heavy_fdproblem.createProblem(heavy.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> heavy_problem =
+      std::make_shared<FullDynamicsProblem>(heavy_fdproblem);
+  mpc_settings.support_force = mpc.getSettings().support_force;
+  mpc_settings.max_iters = 100;
+  MPC heavy_mpc = MPC(mpc_settings, heavy_problem);
+  mpc.getOCPSolver().setMaxIters(100);
+  for (std::size_t i = 0; i < 3; i++) {
+    mpc.iterate(q, v);
+    heavy_mpc.iterate(q, v);
+  }
+  BOOST_CHECK(mpc.us_[0].isApprox(heavy_mpc.us_[0], 1e-3));
+  BOOST_CHECK(mpc.xs_[1].isApprox(heavy_mpc.xs_[1], 1e-3));
+}
+
+BOOST_AUTO_TEST_CASE(mpc_model_variants) {
+  RobotHandler handler = getTalosHandler();
+  RobotHandler legs = getTalosLegsHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  FullDynamicsProblem fdproblem(settings, handler);
+  size_t T = 30;
+  fdproblem.createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(fdproblem);
+
+  // Weights of the joints left in the legs model, the arms come last
+  const int nv = legs.getModel().nv;
+  FullDynamicsSettings legs_settings = settings;
+  Eigen::VectorXd w_x(2 * nv);
+  w_x << settings.w_x.diagonal().head(nv),
+      settings.w_x.diagonal().segment(handler.getModel().nv, nv);
+  legs_settings.w_x = w_x.asDiagonal();
+  legs_settings.w_u = settings.w_u.topLeftCorner(nv - 6, nv - 6);
+  legs_settings.umin = settings.umin.head(nv - 6);
+  legs_settings.umax = settings.umax.head(nv - 6);
+  legs_settings.qmin = settings.qmin.head(nv - 6);
+  legs_settings.qmax = settings.qmax.head(nv - 6);
+  FullDynamicsProblem legs_fdproblem(legs_settings, legs);
+  legs_fdproblem.createProblem(legs.getState(), T, 6, -settings.gravity[2]);
+  std::shared_ptr<Problem> legs_problem =
+      std::make_shared<FullDynamicsProblem>(legs_fdproblem);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+
+  MPC mpc = MPC(mpc_settings, problem);
+  mpc.addModelVariant("legs", legs_problem);
+  BOOST_CHECK_THROW(mpc.addModelVariant("legs", legs_problem),
+                    std::runtime_error);
+  BOOST_CHECK_THROW(mpc.switchModelVariant("arms"), std::runtime_error);
+
+  std::vector<std::map<std::string, bool>> contact_phases;
+  std::map<std::string, bool> double_support = {{"left_sole_link", true},
+                                                {"right_sole_link", true}};
+  std::map<std::string, bool> left_support = {{"left_sole_link", true},
+                                              {"right_sole_link", false}};
+  contact_phases.insert(contact_phases.end(), 10, double_support);
+  contact_phases.insert(contact_phases.end(), 20, left_support);
+  mpc.generateCycleHorizon(contact_phases);
+
+  // Complete model state, shaped for the active variant
+  const Eigen::VectorXd q = handler.getCompleteConfiguration();
+  const Eigen::VectorXd v =
+      Eigen::VectorXd::Zero(handler.getCompleteModel().nv);
+  for (std::size_t i = 0; i < 15; i++)
+    mpc.iterate(q, v);
+  const std::size_t support = problem->getContactSupport(T - 1);
+
+  mpc.switchModelVariant("legs");
+  BOOST_CHECK_EQUAL(mpc.getModelVariant(), "legs");
+  BOOST_CHECK_EQUAL(mpc.getHandler().getModel().nv, nv);
+  BOOST_CHECK_EQUAL(mpc.xs_[0].size(), legs.getModel().nq + nv);
+  BOOST_CHECK_EQUAL(mpc.us_[0].size(), nv - 6);
+  BOOST_CHECK_EQUAL(legs_problem->getContactSupport(T - 1), support);
+
+  mpc.iterate(q, v);
+  BOOST_CHECK_EQUAL(mpc.getSolutionStatus(), MPC::SOLUTION_OK);
+  BOOST_CHECK(mpc.xs_[1].allFinite());
+
+  // Back to the arms, which start at their reference configuration
+  mpc.switchModelVariant("default");
+  BOOST_CHECK_EQUAL(mpc.us_[0].size(), handler.getModel().nv - 6);
+  mpc.iterate(q, v);
+  BOOST_CHECK(mpc.xs_[1].allFinite());
+
+  // A payload reaches the stored variant, which can be switched to
+  const double mass = mpc.getHandler().getMass() + 5;
+  mpc.setMass(mass);
+  BOOST_CHECK_CLOSE(legs_problem->getHandler().getMass(), mass, 1e-6);
+  mpc.switchModelVariant("legs");
+  mpc.iterate(q, v);
+  BOOST_CHECK(mpc.xs_[1].allFinite());
+
+  // A variant with another mass is refused
+  problem->getHandler().setMass(mass + 5);
+  BOOST_CHECK_THROW(mpc.switchModelVariant("default"), std::runtime_error);
+  BOOST_CHECK_EQUAL(mpc.getModelVariant(), "legs");
+}
+
+BOOST_AUTO_TEST_CASE(mpc_solver_backend) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  size_t T = 20;
+  // One problem per MPC, the copies of a problem share their stages
+  std::shared_ptr<Problem> fddp_problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  std::shared_ptr<Problem> auto_problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  for (auto &problem : {fddp_problem, auto_problem})
+    problem->createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  const Eigen::VectorXd q = handler.getState().head(handler.getModel().nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+
+  mpc_settings.solver_backend = SOLVER_FDDP;
+  MPC fddp(mpc_settings, fddp_problem);
+  fddp.iterate(q, v);
+  BOOST_CHECK_EQUAL(fddp.getSolverBackend(), SOLVER_FDDP);
+  BOOST_CHECK(fddp.xs_[1].allFinite());
+  BOOST_CHECK_EQUAL(fddp.K0_.rows(), fddp.us_[0].size());
+  BOOST_CHECK_THROW(fddp.getSolver(), std::runtime_error);
+
+  // Full dynamics stages always have control bounds
+  mpc_settings.solver_backend = SOLVER_AUTO;
+  MPC automatic(mpc_settings, auto_problem);
+  BOOST_CHECK(AutoSolver::hasConstraints(automatic.getTrajOptProblem()));
+  automatic.iterate(q, v);
+  BOOST_CHECK_EQUAL(automatic.getSolverBackend(), SOLVER_PROXDDP);
+  BOOST_CHECK(automatic.xs_[1].allFinite());
+}
+
+BOOST_AUTO_TEST_CASE(mpc_command_predictor) {
+  RobotHandler handler = getTalosHandler();
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  size_t T = 20;
+  // One problem per MPC, the copies of a problem share their stages
+  std::shared_ptr<Problem> problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  std::shared_ptr<Problem> plain_problem =
+      std::make_shared<FullDynamicsProblem>(settings, handler);
+  for (auto &p : {problem, plain_problem})
+    p->createProblem(handler.getState(), T, 6, -settings.gravity[2]);
+
+  MPCSettings mpc_settings;
+  mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+  mpc_settings.num_threads = 1;
+  mpc_settings.T = T;
+  mpc_settings.predict_command = true;
+  MPC mpc = MPC(mpc_settings, problem);
+  mpc_settings.predict_command = false;
+  MPC plain = MPC(mpc_settings, plain_problem);
+
+  const long nq = handler.getModel().nq;
+  const Eigen::VectorXd q = handler.getState().head(nq);
+  const Eigen::VectorXd v = handler.getState().tail(handler.getModel().nv);
+  mpc.iterate(q, v);
+  plain.iterate(q, v);
+
+  // The tail base velocity gets the whole command change, in the base frame
+  Eigen::VectorXd velocity_base = Eigen::VectorXd::Zero(6);
+  velocity_base[0] = 0.2;
+  const std::vector<Eigen::VectorXd> xs = mpc.xs_;
+  const std::vector<Eigen::VectorXd> us = mpc.us_;
+  mpc.setVelocityBase(velocity_base);
+  mpc.predictCommandChange(0);
+  const Eigen::Quaterniond quat(xs.back().segment<4>(3));
+  const Eigen::Matrix3d R = quat.normalized().toRotationMatrix();
+  BOOST_CHECK(
+      (mpc.xs_.back().segment(nq, 3) - xs.back().segment(nq, 3))
+          .isApprox(R.transpose() * velocity_base.head(3), 1e-9));
+  BOOST_CHECK(mpc.xs_[0].isApprox(xs[0]));
+  mpc.xs_ = xs;
+  mpc.us_ = us;
+
+  // The tick after the command change starts from the predicted plan, closer
+  // to the solution than the shifted one
+  mpc.switchToWalk(velocity_base);
+  plain.switchToWalk(velocity_base);
+  mpc.iterate(q, v);
+  plain.iterate(q, v);
+  BOOST_CHECK_EQUAL(mpc.getSolutionStatus(), MPC::SOLUTION_OK);
+  for (auto const &x : mpc.xs_)
+    BOOST_CHECK(x.allFinite());
+  for (auto const &u : mpc.us_)
+    BOOST_CHECK(u.allFinite());
+  const ResultsBase &results = mpc.getOCPSolver().getResults();
+  const ResultsBase &plain_results = plain.getOCPSolver().getResults();
+  BOOST_CHECK(results.num_iters < plain_results.num_iters or
+              results.traj_cost_ <= plain_results.traj_cost_);
+
+  // The gains of a rejected solve are not used for the prediction
+  Eigen::MatrixXd w_u = settings.w_u;
+  w_u(0, 0) = std::numeric_limits<double>::quiet_NaN();
+  mpc.setCostWeights("control_cost", w_u);
+  mpc.iterate(q, v);
+  BOOST_CHECK(mpc.getSolutionStatus() != MPC::SOLUTION_OK);
+  const std::vector<Eigen::VectorXd> us_rejected = mpc.us_;
+  mpc.setVelocityBase(Eigen::VectorXd::Zero(6));
+  mpc.predictCommandChange(0);
+  for (std::size_t t = 0; t < us_rejected.size(); t++)
+    BOOST_CHECK(mpc.us_[t].isApprox(us_rejected[t]));
+}
+
+BOOST_AUTO_TEST_CASE(foot_trajectory_in_place) {
+  point3_t start(0, 0.1, 0);
+  point3_t end(0.2, 0.1, 0.05);
+  std::map<std::string, point3_t> initial_poses = {{"foot", start}};
+  FootTrajectory foot_trajectory(initial_poses, 0.1, 20, 10, 50);
+
+  foot_trajectory.updateTrajectory(true, 15, start, end, "foot");
+  std::vector<point3_t> expected = foot_trajectory.createTrajectory(
+      15, start, end, foot_trajectory.defineTranslationBezier(start, end));
+
+  const std::vector<point3_t> &reference = foot_trajectory.getReference("foot");
+  BOOST_CHECK_EQUAL(reference.size(), expected.size());
+  for (std::size_t i = 0; i < reference.size(); i++)
+    BOOST_CHECK((reference[i] - expected[i]).isZero(1e-6));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
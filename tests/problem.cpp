@@ -98,6 +98,87 @@ BOOST_AUTO_TEST_CASE(fulldynamics) {
                               force_refs.at("left_sole_link"));
   BOOST_CHECK_EQUAL(fdproblem.getReferenceForce(5, "left_sole_link"),
                     force_refs.at("left_sole_link"));
+
+  Eigen::MatrixXd w_cent = settings.w_cent * 2;
+  fdproblem.setCostWeights("centroidal_cost", w_cent);
+  for (std::size_t t = 0; t < fdproblem.getSize(); t++) {
+    QuadraticResidualCost *qrc =
+        fdproblem.getCostStack(t)->getComponent<QuadraticResidualCost>(
+            "centroidal_cost");
+    BOOST_CHECK_EQUAL(qrc->weights_, w_cent);
+  }
+  BOOST_CHECK_THROW(fdproblem.setCostWeights("centroidal_cost", settings.w_u),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(fulldynamics_stance_pruning) {
+  RobotHandler handler = getTalosHandler();
+
+  std::map<std::string, bool> contact_states;
+  std::map<std::string, bool> land_constraint;
+  std::map<std::string, pinocchio::SE3> contact_poses;
+  std::map<std::string, Eigen::VectorXd> force_refs;
+  Eigen::VectorXd f1(6);
+  f1 << 0, 0, 800, 0, 0, 0;
+  contact_states.insert({"left_sole_link", true});
+  contact_states.insert({"right_sole_link", false});
+  land_constraint.insert({"left_sole_link", false});
+  land_constraint.insert({"right_sole_link", false});
+  contact_poses.insert(
+      {"left_sole_link", handler.getFootPose("left_sole_link")});
+  contact_poses.insert(
+      {"right_sole_link", handler.getFootPose("right_sole_link")});
+  force_refs.insert({"left_sole_link", f1});
+  force_refs.insert({"right_sole_link", Eigen::VectorXd::Zero(6)});
+
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+  settings.prune_stance_costs = true;
+  FullDynamicsProblem fdproblem(settings, handler);
+  StageModel sm = fdproblem.createStage(contact_states, contact_poses,
+                                        force_refs, land_constraint);
+  CostStack *cs = dynamic_cast<CostStack *>(&*sm.cost_);
+
+  // Only the swing foot keeps its pose cost
+  BOOST_CHECK_EQUAL(cs->components_.size(), 5);
+  BOOST_CHECK(cs->components_.find("left_sole_link_pose_cost") ==
+              cs->components_.end());
+  BOOST_CHECK(cs->components_.find("right_sole_link_pose_cost") !=
+              cs->components_.end());
+
+  // Double support everywhere: pose references are ignored
+  fdproblem.createProblem(handler.getState(), 10, 6, settings.gravity[2]);
+  BOOST_CHECK_EQUAL(fdproblem.getCostNumber(), 5);
+  pinocchio::SE3 pose = pinocchio::SE3::Random();
+  fdproblem.setReferencePose(4, "left_sole_link", pose);
+  BOOST_CHECK_THROW(fdproblem.getReferencePose(4, "left_sole_link"),
+                    std::runtime_error);
+  BOOST_CHECK_THROW(
+      fdproblem.setCostWeights("left_sole_link_pose_cost", settings.w_frame),
+      std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(joint_limit_residual) {
+  RobotHandler handler = getTalosHandler();
+  const Model &model = handler.getModel();
+  Eigen::VectorXd x = handler.getState();
+  int nu = model.nv - 6;
+
+  JointLimitResidual joint_fn(model, nu);
+  std::shared_ptr<JointLimitResidual::Data> joint_data = joint_fn.createData();
+  joint_fn.evaluate(x, *joint_data);
+  joint_fn.computeJacobians(x, *joint_data);
+
+  // Former formulation: joint rows of the full state error
+  MultibodyPhaseSpace space(model);
+  StateErrorResidual state_fn(space, nu, space.neutral());
+  auto state_data = state_fn.createData();
+  state_fn.evaluate(x, *state_data);
+  state_fn.computeJacobians(x, *state_data);
+
+  BOOST_CHECK(
+      joint_data->value_.isApprox(state_data->value_.segment(6, model.nv - 6)));
+  BOOST_CHECK(
+      joint_data->Jx_.isApprox(state_data->Jx_.middleRows(6, model.nv - 6)));
 }
 
 BOOST_AUTO_TEST_CASE(kinodynamics) {
@@ -189,6 +270,79 @@ BOOST_AUTO_TEST_CASE(kinodynamics) {
                     force_refs.at("left_sole_link"));
 }
 
+BOOST_AUTO_TEST_CASE(kinodynamics_active_forces) {
+  RobotHandler handler = getTalosHandler();
+  int nv = handler.getModel().nv;
+
+  std::map<std::string, bool> contact_states;
+  std::map<std::string, bool> land_constraint;
+  std::map<std::string, pinocchio::SE3> contact_poses;
+  std::map<std::string, Eigen::VectorXd> force_refs;
+  Eigen::VectorXd f1(6);
+  f1 << 0, 0, 800, 0, 0, 0;
+  contact_states.insert({"left_sole_link", true});
+  contact_states.insert({"right_sole_link", false});
+  land_constraint.insert({"left_sole_link", false});
+  land_constraint.insert({"right_sole_link", false});
+  contact_poses.insert(
+      {"left_sole_link", handler.getFootPose("left_sole_link")});
+  contact_poses.insert(
+      {"right_sole_link", handler.getFootPose("right_sole_link")});
+  force_refs.insert({"left_sole_link", f1});
+  force_refs.insert({"right_sole_link", Eigen::VectorXd::Zero(6)});
+
+  KinodynamicsSettings settings = getKinodynamicsSettings(handler);
+  settings.active_forces_only = true;
+  KinodynamicsProblem knproblem(settings, handler);
+  knproblem.createProblem(handler.getState(), 10, 6, settings.gravity[2]);
+  BOOST_CHECK_EQUAL(knproblem.getProblem()->stages_[0]->nu(), nv + 6);
+
+  // The swing foot has no force variables
+  StageModel sm = knproblem.createStage(contact_states, contact_poses,
+                                        force_refs, land_constraint);
+  BOOST_CHECK_EQUAL(sm.nu(), nv);
+  knproblem.getProblem()->stages_[3] = sm;
+
+  BOOST_CHECK_EQUAL(knproblem.getReferenceForce(3, "left_sole_link"), f1);
+  BOOST_CHECK_EQUAL(knproblem.getReferenceForce(3, "right_sole_link"),
+                    Eigen::VectorXd::Zero(6));
+
+  force_refs.at("left_sole_link")[0] = 1;
+  force_refs.at("right_sole_link")[2] = 1;
+  knproblem.setReferenceForces(3, force_refs);
+  BOOST_CHECK_EQUAL(knproblem.getReferenceControl(3).size(), nv);
+  BOOST_CHECK_EQUAL(knproblem.getReferenceForce(3, "left_sole_link"),
+                    force_refs.at("left_sole_link"));
+  BOOST_CHECK_EQUAL(knproblem.getReferenceForce(3, "right_sole_link"),
+                    Eigen::VectorXd::Zero(6));
+
+  Eigen::VectorXd u = Eigen::VectorXd::Ones(nv);
+  Eigen::VectorXd u_full = knproblem.getFullControl(3, u);
+  BOOST_CHECK_EQUAL(u_full.size(), nv + 6);
+  BOOST_CHECK_EQUAL(u_full.segment(6, 6), Eigen::VectorXd::Zero(6));
+  BOOST_CHECK_EQUAL(u_full.tail(nv - 6), u.tail(nv - 6));
+
+  // Full control weights are restricted to the stage variables
+  knproblem.setCostWeights("control_cost", settings.w_u * 2);
+  QuadraticControlCost *cc =
+      knproblem.getCostStack(3)->getComponent<QuadraticControlCost>(
+          "control_cost");
+  BOOST_CHECK_EQUAL(cc->weights_.rows(), nv);
+  BOOST_CHECK_EQUAL(cc->weights_(0, 0), settings.w_u(0, 0) * 2);
+
+  // Weights fitting the first stage but not the next ones leave every stage
+  // unchanged
+  knproblem.getProblem()->stages_[0] = sm;
+  QuadraticControlCost *cc0 =
+      knproblem.getCostStack(0)->getComponent<QuadraticControlCost>(
+          "control_cost");
+  const Eigen::MatrixXd w_before = cc0->weights_;
+  BOOST_CHECK_THROW(knproblem.setCostWeights(
+                        "control_cost", Eigen::MatrixXd::Identity(nv, nv)),
+                    std::runtime_error);
+  BOOST_CHECK_EQUAL(cc0->weights_, w_before);
+}
+
 BOOST_AUTO_TEST_CASE(centroidal) {
   RobotHandler handler = getTalosHandler();
   CentroidalSettings settings = getCentroidalSettings();
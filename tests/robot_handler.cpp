@@ -1,5 +1,6 @@
 
 #include <boost/test/unit_test.hpp>
+#include <pinocchio/algorithm/frames.hpp>
 
 #include "simple-mpc/fwd.hpp"
 #include "simple-mpc/robot-handler.hpp"
@@ -36,6 +37,19 @@ BOOST_AUTO_TEST_CASE(build_talos) {
   BOOST_CHECK_EQUAL(handler.getConfiguration(), q2);
 
   Eigen::MatrixXd M = handler.getMassMatrix();
+
+  pinocchio::Data data = handler.getData();
+  const FrameKinematicsCache &kinematics = handler.getFrameKinematics();
+  FrameIndex id = handler.getFootId("left_sole_link");
+  std::size_t slot = kinematics.getSlot(id);
+  BOOST_CHECK(kinematics.getVelocityWorldAligned(slot).isApprox(
+      getFrameVelocity(handler.getModel(), data, id, LOCAL_WORLD_ALIGNED)));
+  BOOST_CHECK(kinematics.getJacobianWorldAligned(slot).isApprox(
+      getFrameJacobian(handler.getModel(), data, id, LOCAL_WORLD_ALIGNED)));
+  Data::Matrix6x dJ = Data::Matrix6x::Zero(6, handler.getModel().nv);
+  getFrameJacobianTimeVariation(handler.getModel(), data, id, LOCAL, dJ);
+  BOOST_CHECK(kinematics.getJacobianTimeVariation(slot).isApprox(dJ));
+  BOOST_CHECK_THROW(kinematics.getSlot(0), std::runtime_error);
 }
 
 BOOST_AUTO_TEST_CASE(build_solo) {
@@ -57,4 +71,69 @@ BOOST_AUTO_TEST_CASE(build_solo) {
   pinocchio::SE3 pose = handler.getFootPose("FL_FOOT");
 }
 
+BOOST_AUTO_TEST_CASE(update_inertias) {
+  RobotHandler handler = getSoloHandler();
+  RobotHandler copy = handler;
+  const double mass = handler.getMass();
+
+  // Payload on the base
+  pinocchio::JointIndex root = handler.getModel().getJointId("root_joint");
+  pinocchio::Inertia base = handler.getModel().inertias[root];
+  pinocchio::Inertia payload(1., Eigen::Vector3d(0, 0, 0.1),
+                             Eigen::Matrix3d::Identity() * 1e-3);
+  std::shared_ptr<const pinocchio::Model> snapshot = handler.getModelHandle();
+  handler.setLinkInertia("root_joint", base + payload);
+  BOOST_CHECK_CLOSE(handler.getMass(), mass + 1., 1e-9);
+  BOOST_CHECK_THROW(handler.setLinkInertia("no_joint", payload),
+                    std::runtime_error);
+
+  // Copies have their own model, and the snapshot only changes once
+  // published
+  BOOST_CHECK(copy.getModel().inertias[root].isApprox(base));
+  BOOST_CHECK_CLOSE(copy.getMass(), mass, 1e-9);
+  BOOST_CHECK(handler.getModelHandle() == snapshot);
+  BOOST_CHECK(handler.publishModel() == handler.getModelHandle());
+  BOOST_CHECK(
+      handler.getModelHandle()->inertias[root].isApprox(base + payload));
+  BOOST_CHECK(snapshot->inertias[root].isApprox(base));
+  BOOST_CHECK(copy.getModelHandle() == snapshot);
+
+  handler.setMass(2 * mass);
+  BOOST_CHECK_CLOSE(handler.getMass(), 2 * mass, 1e-9);
+  BOOST_CHECK(handler.getModel().inertias[root].lever().isApprox(
+      (base + payload).lever()));
+}
+
+BOOST_AUTO_TEST_CASE(map_state) {
+  RobotHandler handler = getTalosHandler();
+  RobotHandler legs = getTalosLegsHandler();
+  const Model &model = handler.getModel();
+  BOOST_CHECK_EQUAL(legs.getModel().nv, 20);
+
+  // Legs and torso come first in both models
+  Eigen::VectorXd x = handler.getState();
+  x.segment(7, 8).array() += 0.1;
+  x.tail(model.nv).setRandom();
+  Eigen::VectorXd x_legs = legs.mapState(model, x);
+  BOOST_CHECK(x_legs.head(21).isApprox(x.head(21)));
+  BOOST_CHECK(x_legs.tail(20).isApprox(x.segment(model.nq, 20)));
+
+  // Locked arms come back to the reference configuration, at rest
+  Eigen::VectorXd x_back = handler.mapState(legs.getModel(), x_legs);
+  BOOST_CHECK(x_back.head(21).isApprox(x.head(21)));
+  BOOST_CHECK(
+      x_back.segment(21, 8).isApprox(handler.getState().segment(21, 8)));
+  BOOST_CHECK(x_back.tail(8).isZero());
+
+  Eigen::VectorXd u = Eigen::VectorXd::Random(model.nv - 6);
+  Eigen::VectorXd u_legs = Eigen::VectorXd::Zero(14);
+  legs.mapActuated(model, u, u_legs);
+  BOOST_CHECK(u_legs.isApprox(u.head(14)));
+  Eigen::VectorXd u_back = Eigen::VectorXd::Ones(model.nv - 6);
+  handler.mapActuated(legs.getModel(), u_legs, u_back);
+  BOOST_CHECK(u_back.head(14).isApprox(u.head(14)));
+  BOOST_CHECK(u_back.tail(8).isOnes());
+  BOOST_CHECK_THROW(legs.mapState(model, x_legs), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
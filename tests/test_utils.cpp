@@ -35,6 +35,16 @@ RobotHandler getTalosHandler() {
   return handler;
 }
 
+// Same robot with the arms locked
+RobotHandler getTalosLegsHandler() {
+  RobotHandlerSettings settings = getTalosHandler().getSettings();
+  settings.controlled_joints_names.resize(15);
+
+  RobotHandler handler(settings);
+
+  return handler;
+}
+
 RobotHandler getSoloHandler() {
   RobotHandlerSettings settings;
   settings.urdf_path =
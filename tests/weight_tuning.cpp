@@ -0,0 +1,76 @@
+#include <boost/test/unit_test.hpp>
+
+#include "simple-mpc/fulldynamics.hpp"
+#include "simple-mpc/mpc.hpp"
+#include "simple-mpc/robot-handler.hpp"
+#include "simple-mpc/weight-tuning.hpp"
+#include "test_utils.cpp"
+
+BOOST_AUTO_TEST_SUITE(weight_tuning)
+
+using namespace simple_mpc;
+
+BOOST_AUTO_TEST_CASE(cmaes_ellipsoid) {
+  CMAES cmaes(Eigen::VectorXd::Constant(4, 2.), 0.5, 0, 1);
+  for (std::size_t g = 0; g < 150; g++) {
+    const std::vector<Eigen::VectorXd> &samples = cmaes.ask();
+    std::vector<double> costs;
+    for (auto const &x : samples)
+      costs.push_back(100 * x[0] * x[0] + x.tail(3).squaredNorm());
+    cmaes.tell(costs);
+  }
+  BOOST_CHECK_SMALL(cmaes.getMean().norm(), 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(weight_tuner) {
+  RobotHandler handler = getTalosHandler();
+  FullDynamicsSettings settings = getFullDynamicsSettings(handler);
+
+  auto factory = [&]() {
+    std::shared_ptr<Problem> problem =
+        std::make_shared<FullDynamicsProblem>(settings, handler);
+    problem->createProblem(handler.getState(), 20, 6, -settings.gravity[2]);
+
+    MPCSettings mpc_settings;
+    mpc_settings.support_force = -handler.getMass() * settings.gravity[2];
+    mpc_settings.num_threads = 1;
+    mpc_settings.T = 20;
+    mpc_settings.verbose = false;
+    std::shared_ptr<MPC> mpc = std::make_shared<MPC>(mpc_settings, problem);
+
+    std::vector<std::map<std::string, bool>> contact_states;
+    for (std::size_t i = 0; i < 10; i++) {
+      std::map<std::string, bool> contact_state;
+      contact_state.insert({handler.getFootName(0), true});
+      contact_state.insert({handler.getFootName(1), true});
+      contact_states.push_back(contact_state);
+    }
+    mpc->generateCycleHorizon(contact_states);
+    return mpc;
+  };
+
+  TuningSettings tuning;
+  tuning.generations = 2;
+  tuning.population_size = 4;
+  tuning.episode_length = 5;
+  tuning.num_threads = 2;
+
+  std::vector<TunedCost> costs;
+  costs.push_back({"centroidal_cost", settings.w_cent.diagonal()});
+  WeightTuner tuner(tuning, factory, costs, WeightTuner::defaultObjective);
+  BOOST_CHECK_EQUAL(tuner.getNumParameters(), 6);
+
+  // Episodes start from the same state whatever ran before
+  EpisodeStatistics first = tuner.runEpisode(Eigen::VectorXd::Zero(6));
+  tuner.runEpisode(Eigen::VectorXd::Constant(6, 1.));
+  EpisodeStatistics again = tuner.runEpisode(Eigen::VectorXd::Zero(6));
+  BOOST_CHECK_EQUAL(first.ticks, 5);
+  BOOST_CHECK_CLOSE(first.tracking_error, again.tracking_error, 1e-6);
+
+  TuningResult result = tuner.optimize();
+  BOOST_CHECK_EQUAL(result.history.size(), 2);
+  BOOST_CHECK(std::isfinite(result.best_objective));
+  BOOST_CHECK_EQUAL(result.best_weights.at("centroidal_cost").size(), 6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()